@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// Bump allocator for short-lived allocations (launch path).
+// Memory is never freed individually. Instead a mark is taken before
+// a group of allocations and everything after it is dropped with
+// arenaReset(). arenaRelease() frees the whole arena.
+typedef struct
+{
+	u8 *mem;
+	u32 size;
+	u32 used;
+	u32 peak; // Highest used value since arenaInit().
+} Arena;
+
+typedef u32 ArenaMark;
+
+
+Result arenaInit(Arena *const arena, const u32 size);
+
+// Returns 8 bytes aligned memory or NULL if the arena is full.
+void* arenaAlloc(Arena *const arena, const u32 size);
+
+// Same as arenaAlloc() but the memory is zeroed.
+void* arenaCalloc(Arena *const arena, const u32 size);
+
+char* arenaStrdup(Arena *const arena, const char *const str);
+void arenaReset(Arena *const arena, const ArenaMark mark);
+void arenaRelease(Arena *const arena);
+
+static inline ArenaMark arenaMark(const Arena *const arena)
+{
+	return arena->used;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+
+
+// Packed cheat database built by tools/cheat-db-builder.
+//
+// Layout: CheatDbHeader, numEntries CheatDbEntry sorted by game code
+// and ROM CRC32, then the cheats of each entry. The cheats are null
+// terminated text in the .cht format (see cheats.h) and stored in
+// index order so all entries of a game are read at once.
+#define CHEAT_DB_PATH         "cheats.bin" // Relative to work dir.
+#define CHEAT_DB_MAGIC        (0x4244434Fu) // "OCDB"
+#define CHEAT_DB_VERSION      (1u)
+#define CHEAT_DB_MAX_ENTRIES  (8192u)
+#define CHEAT_DB_MAX_CHEATS   (1024u * 32) // Per game code.
+#define CHEAT_DB_MAX_MATCHES  (64u)        // Entries per game code.
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 reserved;
+	u32 numEntries;
+} CheatDbHeader;
+
+typedef struct
+{
+	u32 gameCode; // As stored at 0xAC in the ROM header.
+	u32 romCrc;   // CRC32 of the unpatched ROM. 0 = all revisions.
+	u32 offset;   // Of the cheats from the start of the file.
+	u32 size;     // Including the null terminator.
+} CheatDbEntry;
+
+typedef struct
+{
+	const CheatDbEntry *entries;
+	u32 num;
+	const char *data; // Cheats of entries[0]. The others follow.
+} CheatDbMatch;
+
+
+// Reads all entries for the game code. The index is binary searched on
+// disk so only the entries of the game and their cheats are loaded.
+// Returns RES_NOT_FOUND if there are none.
+Result cheatDbFind(const char *const path, u32 gameCode, CheatDbMatch *const match, Arena *const arena);
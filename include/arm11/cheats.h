@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+#include "arm11/rom_info.h"
+
+
+// Cheats are ROM writes applied once before the game starts.
+// Cheat files are INI files with one section per cheat:
+//   [Infinite health]
+//   enabled=true
+//   code=6A01B2C3 00001234
+//   code=0800ABCD:46C0
+//
+// Supported codes:
+//   AAAAAAAA:VV/VVVV/VVVVVVVV  8/16/32 bit little endian write at ROM address 08000000-09FFFFFF.
+//   6AAAAAAA X000VVVV          Decrypted GameShark v1/v2 16 bit ROM patch at 08000000 + AAAAAAA * 2.
+// Cheats with other codes (RAM writes, encrypted codes) are skipped.
+//
+// Cheats from the cheat database (cheat_db.h) are parsed before the
+// cheat file. A section in the cheat file with the name of a database
+// cheat changes its enabled state.
+//
+// Enabled cheats are compiled into sorted extents (offset, size, bytes)
+// and cached next to the cheat file.
+#define CHEATS_DIR          "cheats" // Relative to work dir.
+#define CHEAT_FILE_MAX      (1024u * 16)
+#define CHEAT_MAX_CHEATS    (256u)
+#define CHEAT_MAX_WRITES    (1024u)
+
+#define CHEAT_CACHE_MAGIC   (0x5448434Fu) // "OCHT"
+#define CHEAT_CACHE_VERSION (4u)
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 reserved;
+	u32 romSize;    // Patched ROM size. The cache is used if ROM and cheat file match.
+	RomInfo rom;    // Unpatched ROM file. The CRC32 is only valid if it was needed.
+	u32 chtSize;    // 0 if there is no cheat file.
+	u16 chtFdate;
+	u16 chtFtime;
+	u32 dbSize;     // 0 if there is no cheat database.
+	u16 dbFdate;
+	u16 dbFtime;
+	u32 numExtents;
+	u32 dataSize;
+} CheatCacheHeader;
+
+// Followed by the bytes of all extents in order.
+typedef struct
+{
+	u32 offset;
+	u32 size;
+} CheatExtent;
+
+
+// Calculates the CRC32 of the unpatched ROM if the cheat database has
+// cheats for a specific revision of the game. Call before the ROM at
+// ROM_LOC is patched. The CRC32 is taken from the cheat cache if the
+// ROM file didn't change.
+Result cheatsPrepare(const char *const romPath, RomInfo *const rom, Arena *const arena);
+
+// Applies the enabled cheats for the ROM at romPath to the ROM at ROM_LOC.
+// rom is from cheatsPrepare(). Returns RES_FR_NO_FILE if there is neither
+// a cheat file nor a database.
+Result cheatsApply(const char *const romPath, const u32 romSize, const RomInfo *const rom,
+                   Arena *const arena);
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// Sidecar index for files of fixed size records sorted by a u64 key
+// (gba_db.bin). Instead of seeking through the file for every step of
+// a binary search, the keys are searched in memory and only the found
+// record is read.
+//
+// Layout: DbIndexHeader followed by num u64 keys in file order.
+#define DB_INDEX_MAGIC    (0x49424447u) // "GDBI"
+#define DB_INDEX_VERSION  (1u)
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 keyOffset;
+	u32 entrySize;
+	u32 dbSize;   // Rebuilt if size, date or time of the database change.
+	u16 dbFdate;
+	u16 dbFtime;
+	u32 num;
+} DbIndexHeader;
+
+
+// Finds the record with the given key. The index is (re)built if
+// missing or out of date. Returns RES_NOT_FOUND if there is no record
+// with the key. Any other error means the index can't be used.
+Result dbIndexFind(const char *const dbPath, const char *const idxPath, u32 entrySize, u16 keyOffset,
+                   u64 key, s32 *const entryPos);
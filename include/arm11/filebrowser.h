@@ -19,6 +19,7 @@
  */
 
 #include "error_codes.h"
+#include "arm11/arena.h"
 
 // Notes on these settings:
 // MAX_ENT_BUF_SIZE should be big enough to hold the average file/dir name length * MAX_DIR_ENTRIES.
@@ -39,6 +40,8 @@ typedef struct
 } DirList;
 
 
-Result browseFiles(const char *const basePath, char selected[512]);
+Result browseFiles(const char *const basePath, char selected[512], Arena *const arena);
 void showDirList(const DirList *const dList, u32 start);
+// Same as showDirList() but only uses the first rows rows of the screen.
+void showDirListRows(const DirList *const dList, u32 start, u32 rows);
 int dlistCompare(const void *a, const void *b);
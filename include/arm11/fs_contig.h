@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// Smaller files fit in a few clusters and are not worth the extra FAT scan.
+#define CONTIG_MIN_SIZE  (1024u * 64)
+
+
+// Same as fsQuickWrite() but files of at least CONTIG_MIN_SIZE bytes are
+// allocated as one contiguous cluster run (fExpand()) before writing.
+// Falls back to normal cluster by cluster allocation if there is no
+// contiguous free space big enough.
+Result fsQuickWriteContig(const char *const path, const void *const buf, u32 size);
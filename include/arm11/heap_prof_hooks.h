@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Debug builds include this in every ARM11 C file (see arm11/Makefile).
+// libn3ds already owns the -Wl,-wrap=malloc,-wrap=calloc,-wrap=free
+// wrappers so the profiler hooks the calls at compile time instead.
+// stdlib.h must come first so its declarations are not renamed.
+#include <stddef.h>
+#include <stdlib.h>
+
+
+#ifndef NDEBUG
+void* heapProfMalloc(size_t size);
+void* heapProfCalloc(size_t num, size_t size);
+void* heapProfRealloc(void *ptr, size_t size);
+void heapProfFree(void *ptr);
+
+#define malloc(size)        heapProfMalloc(size)
+#define calloc(num, size)   heapProfCalloc(num, size)
+#define realloc(ptr, size)  heapProfRealloc(ptr, size)
+#define free(ptr)           heapProfFree(ptr)
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// Heap profiler for debug builds. Allocations of all ARM11 C files are
+// redirected to it by arm11/heap_prof_hooks.h. Use
+// tools/heap-profile-decoder to read the report.
+#define HEAP_PROF_MAGIC    (0x46525048u) // "HPRF"
+#define HEAP_PROF_VERSION  (1u)
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 numSites;
+	u32 totalAllocs;
+	u32 totalBytes;
+	u32 liveBytes;      // At the time the report was written.
+	u32 peakLiveBytes;
+	u32 failedAllocs;
+	u32 untracked;      // Allocations which didn't fit in the tracking table.
+} HeapProfHeader;
+
+typedef struct
+{
+	u32 callSite;       // Return address of the malloc()/calloc() call.
+	u32 allocs;
+	u32 frees;
+	u32 totalBytes;
+	u32 liveCount;      // Not freed (leaked if still live at the end).
+	u32 liveBytes;
+	u32 peakLiveBytes;
+} HeapProfSite;
+// Report: HeapProfHeader followed by numSites HeapProfSite entries.
+
+
+#ifndef NDEBUG
+// Makes the wrappers safe to call from multiple tasks.
+// Call before the first task is created.
+void heapProfInit(void);
+
+Result heapProfWriteReport(const char *const path);
+#else
+static inline void heapProfInit(void)
+{
+}
+
+static inline Result heapProfWriteReport(const char *const path)
+{
+	(void)path;
+	return RES_OK;
+}
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+typedef struct
+{
+	u32 held;
+	u32 down;  // Newly pressed since the previous snapshot.
+	u32 up;    // Newly released since the previous snapshot.
+	u32 extra; // hidGetExtraKeys(0).
+	u32 frame; // Incremented with each snapshot.
+} InputSnapshot;
+
+
+// While the GBA is running the input task is the only caller of
+// hidScanInput() so key edges can't be consumed by another context.
+void inputTaskInit(void);
+
+// Scans input once. Called by the frame ready event handler.
+// The input task has a higher priority so the new snapshot is
+// published when this returns.
+void inputTaskScan(void);
+
+// Copies the latest snapshot. Lock-free, never blocks the input task.
+// Compare frame to the previous snapshot to avoid handling edges twice.
+void inputGetSnapshot(InputSnapshot *const out);
+
+void inputTaskDeinit(void);
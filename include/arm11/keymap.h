@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// GBA KEYINPUT bits. Same order as the lower 10 bits of the 3DS keys.
+#define GBA_KEY_A       (1u<<0)
+#define GBA_KEY_B       (1u<<1)
+#define GBA_KEY_SELECT  (1u<<2)
+#define GBA_KEY_START   (1u<<3)
+#define GBA_KEY_RIGHT   (1u<<4)
+#define GBA_KEY_LEFT    (1u<<5)
+#define GBA_KEY_UP      (1u<<6)
+#define GBA_KEY_DOWN    (1u<<7)
+#define GBA_KEY_R       (1u<<8)
+#define GBA_KEY_L       (1u<<9)
+#define GBA_KEY_MASK    (0x3FFu)
+
+// Input for LGY_handleOverrides() if nothing is overridden.
+#define KEYMAP_NO_OVERRIDE  (0xFFFFu)
+
+
+// LUT of GBA buttons for each byte of the 3DS key state.
+extern u16 g_keymapLut[4][256];
+extern bool g_keymapActive;
+
+
+// Handles one entry of the [input] config section. name is a 3DS button
+// and value a '+' separated list of GBA buttons or "NONE".
+// Returns false if the name or a button is unknown.
+bool keymapParse(const char *const name, const char *const value);
+
+// Bit of a 3DS button name in the key state or -1 if unknown.
+s8 keymapKeyBit(const char *const name);
+
+// Builds the LUT. Call once after all configs have been parsed.
+void keymapCompile(void);
+
+// Pressed GBA buttons (active high) for the held 3DS keys.
+static inline u16 keymapGbaKeys(const u32 kHeld)
+{
+	return g_keymapLut[0][kHeld & 0xFFu] | g_keymapLut[1][kHeld>>8 & 0xFFu] |
+	       g_keymapLut[2][kHeld>>16 & 0xFFu] | g_keymapLut[3][kHeld>>24];
+}
+
+// Input for LGY_handleOverrides() (active low like KEYINPUT).
+// Without remapped buttons the hardware mapping is left alone unless force is true.
+static inline u16 keymapOverrides(const u32 kHeld, const bool force)
+{
+	if(!g_keymapActive && !force) return KEYMAP_NO_OVERRIDE;
+
+	return ~keymapGbaKeys(kHeld) & GBA_KEY_MASK;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// Input to photon latency measurement.
+// A press of the test button is timestamped when the input is scanned.
+// The latency ends at the first frame with a checksum different from the
+// last frame shown before the press once it has been swapped to the top
+// screen. Use a static screen which only changes on the test button (for
+// example a test ROM) for useful results.
+#define LATENCY_MAX_SAMPLES  (256u)
+#define LATENCY_TIMEOUT      (30u) // Frames until a press without frame change is dropped.
+
+
+// testKey is a 3DS key mask. 0 disables the measurement.
+void latencyInit(u32 testKey);
+
+// Called by the input task with the newly pressed keys.
+void latencyInput(u32 kDown);
+
+// Called by gbaGfxHandler() after each frame has been swapped.
+// frame is the copy in the framebuffer which is not written again
+// until the next swap.
+void latencyFrame(const u32 *const frame, const u32 size);
+
+// Writes the distribution and raw samples as text. Does nothing if disabled.
+Result latencyWriteReport(const char *const path);
@@ -1,4 +1,6 @@
 #pragma once
 #include "types.h"
+#include "arm11/arena.h"
+#include "arm11/rom_info.h"
 
-Result patchRom(const char *const gamePath, u32 *romSize, char* savePath);
\ No newline at end of file
+Result patchRom(const char *const gamePath, u32 *romSize, char* savePath, RomInfo *const rom, Arena *const arena);
\ No newline at end of file
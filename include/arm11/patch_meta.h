@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+#include "arm11/filebrowser.h"
+#include "arm11/rom_info.h"
+
+
+// Summaries of the patches in a patch folder for the patch browser.
+// Only the headers (UPS) or the record headers (IPS) are read and the
+// results are cached in the folder so unchanged patches are not opened
+// again.
+#define PATCH_META_CACHE_NAME  ".patchmeta"
+#define PATCH_META_MAGIC       (0x54454D50u) // "PMET"
+#define PATCH_META_VERSION     (2u)
+
+// Rows at the bottom of the screen used by patchMetaShow().
+#define PATCH_META_ROWS        (3u)
+
+typedef enum
+{
+	PATCH_FMT_INVALID = 0u,
+	PATCH_FMT_IPS     = 1u,
+	PATCH_FMT_UPS     = 2u
+} PatchFormat;
+
+// dstSize is only the highest written offset (IPS without truncation).
+#define PATCH_META_DST_MIN  (1u)
+
+typedef struct
+{
+	u32 nameHash;  // The cached entry is used if name, size, date and time match.
+	u32 fileSize;
+	u16 fdate;
+	u16 ftime;
+	u8 format;     // PatchFormat.
+	u8 flags;
+	u16 reserved;
+	u32 records;   // IPS only.
+	u32 srcSize;   // UPS only.
+	u32 dstSize;
+	u32 srcCrc;    // UPS only.
+	u32 dstCrc;    // UPS only.
+} PatchMeta;
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 reserved;
+	u32 num;
+	RomInfo rom;
+} PatchMetaCacheHeader;
+
+
+// Fills metas[i] for every file in list. dir is the patch folder.
+// Patches not found in the cache are parsed and the cache is rewritten.
+// If rom is not NULL the CRC32 of the ROM at ROM_LOC is filled in when
+// needed. It is taken from the cache if the ROM file didn't change.
+Result patchMetaLoad(const char *const dir, const DirList *const list, PatchMeta *const metas,
+                     RomInfo *const rom, Arena *const arena);
+
+// Removes patches with a declared source size or CRC32 different from
+// the ROM from list and metas. Returns the number of removed patches.
+u32 patchMetaFilter(DirList *const list, PatchMeta *const metas, const RomInfo *const rom);
+
+// Prints the summary in the last PATCH_META_ROWS rows of the screen.
+void patchMetaShow(const PatchMeta *const meta);
@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// The unpatched ROM file. Patches and cheats made for a specific
+// revision match the CRC32 of the whole file. It is only calculated
+// when something needs it and cached by the patch and cheat caches
+// until the file changes.
+typedef struct
+{
+	u32 size;
+	u16 fdate;
+	u16 ftime;
+	u32 crc;
+	u32 crcValid;
+} RomInfo;
+
+
+// Fills rom from the ROM file at romPath. The CRC32 is not calculated.
+Result romInfoInit(const char *const romPath, RomInfo *const rom);
+
+// Takes the CRC32 from cached if it is for the same ROM file.
+void romInfoAdopt(RomInfo *const rom, const RomInfo *const cached);
+
+// Calculates the CRC32 of the ROM at ROM_LOC if it's not known yet.
+// Must be called before the ROM is patched.
+// Returns true if the CRC32 had to be calculated.
+bool romInfoCrc(RomInfo *const rom);
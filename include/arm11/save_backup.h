@@ -0,0 +1,35 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+
+
+// Layout (relative to the work dir):
+// saves/backups/<save name>.idx             SHA1 of the newest backups, newest first.
+// saves/backups/objects/<SHA1 in hex>.sav   Save contents. Shared by all indexes.
+#define SAVE_BACKUP_DIR     "saves/backups"
+#define MAX_BACKUP_DEPTH    (10u)
+
+
+// Backs up the save before it is loaded. Does nothing if the save
+// is identical to the newest backup or depth is 0.
+Result backupSave(const char *const savePath, u8 depth, Arena *const arena);
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+
+
+// Save size in bytes for a SAVE_TYPE_* value. 0 for SAVE_TYPE_NONE.
+u32 saveTypeSize(u16 saveType);
+
+// Infers the save type from the size of an existing save.
+// Flash saves get the same default chip as the SDK string scan.
+// Returns 0xFF if there is no save or the size is ambiguous
+// (for example a smaller save padded by an emulator).
+u16 saveTypeFromSave(const char *const savePath, u32 romSize, Arena *const arena);
+
+// Pads or truncates an existing save in place to the size of saveType.
+// Extra data is only cut off if it can't be part of the save (emulator
+// footers, erased/zero filled padding or mirrors of the save).
+// Returns RES_SAVE_SIZE_MISMATCH and leaves the file untouched otherwise.
+// EEPROM byte order conversion is done by tools/save-converter.
+Result convertSave(const char *const savePath, u16 saveType, Arena *const arena);
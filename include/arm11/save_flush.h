@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// Writes the GBA save to the SD card in a background task while
+// playing. The save is only copied while the GBA is asleep or paused so
+// it never changes during the copy.
+// interval is in seconds between paused writes. 0 only writes on sleep.
+void saveFlushInit(u16 interval);
+
+// Call from the frame handler once per frame while the GBA is awake.
+// Starts a paused write when the interval has passed.
+void saveFlushFrame(void);
+
+// Call after the GBA was put to sleep. Starts a write.
+void saveFlushSleep(void);
+
+// True while a write runs. The GBA must not be put to sleep or woken.
+bool saveFlushBusy(void);
+
+void saveFlushDeinit(void);
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+
+
+// Sharded layout (relative to the work dir):
+// saves/<XX>/<game>.ini, .sav, .N.sav, .slots
+// XX is a hash of the game name up to the first dot so all files of a game share a folder.
+// Once saves/.sharded exists the layout stays sharded even if disabled in the config.
+#define SAVE_SHARD_MARKER  "saves/.sharded"
+
+
+// Moves all game files from the flat saves folder into shard folders if
+// enable is true and this wasn't done before. Sharding stays off if this fails.
+Result saveShardInit(bool enable, Arena *const arena);
+
+// Changes "saves/<game>.ini" to "saves/<XX>/<game>.ini" if sharding is on.
+// Game files added to the flat folder later are moved on first use.
+// The path is left unchanged if the shard folder can't be created.
+void saveShardPath(char cfgPath[512]);
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+#define NUM_SAVE_SLOTS     (10u)
+#define SLOT_INDEX_MAGIC   (0x544F4C53u) // "SLOT"
+#define SLOT_INDEX_VERSION (1u)
+
+typedef struct
+{
+	u32 size;    // 0 = empty slot.
+	u16 fdate;   // FAT date/time of the last write.
+	u16 ftime;
+	u8 sha1[20];
+} SaveSlotInfo;
+
+// Stored as "<game>.slots" next to the slot 0 save.
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	SaveSlotInfo slots[NUM_SAVE_SLOTS];
+} SaveSlotIndex;
+
+
+// basePath is the game config path from rom2GameCfgPath()/saveShardPath()
+// ("saves/<game>.ini" or "saves/<XX>/<game>.ini"). Its last 4 chars are
+// replaced to get the slot saves ("<game>.sav", "<game>.1.sav"...) and
+// the index ("<game>.slots").
+// Builds the index once from the save files if it doesn't exist yet.
+Result slotIndexLoad(const char *const basePath, SaveSlotIndex *const idx);
+
+// Re-reads one slot save and writes the updated index.
+// Does nothing if the game has no index yet.
+Result slotIndexUpdate(const char *const basePath, const u8 slot);
+
+// Shows the slot list and returns the selected slot.
+// B or the power button keep the current slot.
+u8 slotPicker(const SaveSlotIndex *const idx, const u8 currentSlot);
@@ -0,0 +1,44 @@
+#pragma once
+
+// Generated by "lgyFbScaler export". Do not edit.
+// Profile n is selected with scaler=n+3 in the config.
+
+#include "types.h"
+
+
+#define NUM_SCALER_PROFILES  (1u)
+
+typedef struct
+{
+	const char *name;
+	u8 hLen;            // Pattern length - 1.
+	u8 hPatt;
+	u8 vLen;            // Pattern length - 1.
+	u8 vPatt;
+	s16 hMatrix[6][8];  // Bits 0-3 are not used.
+	s16 vMatrix[6][8];  // Bits 0-3 are not used.
+} ScalerProfile;
+
+static const ScalerProfile g_scalerProfiles[NUM_SCALER_PROFILES] =
+{
+	{
+		"matrixGba",
+		5, 0x1B, 5, 0x1B,
+		{
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0, 0x2000, 0x4000,      0, 0x2000, 0x4000,      0,      0},
+			{ 0x4000, 0x2000,      0, 0x4000, 0x2000,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0}
+		},
+		{
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0, 0x2000, 0x4000,      0, 0x2000, 0x4000,      0,      0},
+			{ 0x4000, 0x2000,      0, 0x4000, 0x2000,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0},
+			{      0,      0,      0,      0,      0,      0,      0,      0}
+		}
+	}
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+#define SD_WRITE_QUEUE_SIZE  (8u)
+#define SD_WRITE_MAX_PATH    (64u)
+
+// Higher priority writes are done first.
+// Writes with the same priority are done in order.
+typedef enum
+{
+	SD_WRITE_PRIO_LOW    = 0u, // Screenshots, logs.
+	SD_WRITE_PRIO_NORMAL = 1u,
+	SD_WRITE_PRIO_HIGH   = 2u  // Config and state files.
+} SdWritePrio;
+
+// Called once the writer is done with borrowed data. Runs with the
+// writer mutex locked so it must not queue writes.
+typedef void (*SdWriteDone)(const void *data);
+
+
+// Starts the background writer task.
+// Before this and after sdWriterDeinit() all writes are synchronous.
+void sdWriterInit(void);
+
+// Queues a whole file write like fsQuickWrite(). Takes ownership of data
+// which must be allocated with malloc() and is freed after writing.
+// A pending write to the same path is replaced (only the newest data is
+// written). Returns RES_WRITE_QUEUE_FULL if there is no free entry.
+Result sdWriteAsync(const char *const path, void *const data, u32 size, SdWritePrio prio);
+
+// Same as sdWriteAsync() but copies data.
+Result sdWriteAsyncCopy(const char *const path, const void *const data, u32 size, SdWritePrio prio);
+
+// Same as sdWriteAsync() but data is not owned (VRAM for example). It
+// must stay unchanged until done is called. done is also called if the
+// write was replaced or couldn't be queued.
+Result sdWriteAsyncBorrowed(const char *const path, const void *const data, u32 size, SdWritePrio prio,
+                            const SdWriteDone done);
+
+// Blocks until all queued writes are done.
+void sdWriterFlush(void);
+
+// Flushes and stops the writer task.
+void sdWriterDeinit(void);
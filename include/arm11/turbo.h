@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// Frames a turbo button is pressed and then released (1 = 30 Hz at 60 fps).
+#define TURBO_MAX_RATE  (6u)
+// LCM of all turbo periods (2, 4, ... 12 frames).
+#define TURBO_CYCLE     (120u)
+
+
+// Turbo off (released) masks of the 3DS keys for each frame of the cycle.
+extern u32 g_turboLut[TURBO_CYCLE];
+extern volatile u8 g_turboPhase; // Written by gbaGfxHandler().
+extern bool g_turboActive;
+
+
+// Handles "TURBO_<3DS button>=<frames>" entries of the [input] config section.
+// 0 frames disables turbo for the button.
+// Returns false if it's not a turbo entry or invalid.
+bool turboParse(const char *const name, const char *const value);
+
+// Builds the LUT. Call once after all configs have been parsed.
+void turboCompile(void);
+
+// Advances the cycle. Called by the frame ready event handler.
+static inline void turboFrame(void)
+{
+	g_turboPhase = (g_turboPhase < TURBO_CYCLE - 1 ? g_turboPhase + 1 : 0);
+}
+
+// Removes turbo buttons from the held 3DS keys in their off frames.
+static inline u32 turboApply(const u32 kHeld)
+{
+	return kHeld & ~g_turboLut[g_turboPhase];
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+// Input for menus before the GBA is running.
+
+// Sleeps until a button is newly pressed or the power button is pressed.
+// Returns false if the power button was pressed.
+bool uiWaitForKeys(u32 *const kDown);
+
+// Sleeps until exactly the buttons in combo are held and one of them is newly pressed.
+// Powers off if the power button is pressed.
+void uiWaitForCombo(u32 combo);
+
+// Sleeps until the power button is pressed and powers off.
+void uiWaitForPowerOff(void);
+
+// Shuts everything down that was initialized by main() and powers off.
+void uiPowerOff(void);
@@ -29,8 +29,10 @@ enum
 	// Custom errors.
 	RES_ROM_TOO_BIG            = MAKE_CUSTOM_ERR(0u),
 	RES_INVALID_PATCH          = MAKE_CUSTOM_ERR(1u),
+	RES_SAVE_SIZE_MISMATCH     = MAKE_CUSTOM_ERR(2u),
+	RES_WRITE_QUEUE_FULL       = MAKE_CUSTOM_ERR(3u),
 
-	MAX_OAF_RES_VALUE          = RES_ROM_TOO_BIG
+	MAX_OAF_RES_VALUE          = RES_WRITE_QUEUE_FULL
 };
 
 #undef MAKE_CUSTOM_ERR
@@ -0,0 +1,79 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/arena.h"
+
+
+#define ARENA_ALIGN  (8u)
+
+
+Result arenaInit(Arena *const arena, const u32 size)
+{
+	arena->mem  = (u8*)malloc(size);
+	arena->size = (arena->mem != NULL ? size : 0);
+	arena->used = 0;
+	arena->peak = 0;
+
+	return (arena->mem != NULL ? RES_OK : RES_OUT_OF_MEM);
+}
+
+void* arenaAlloc(Arena *const arena, const u32 size)
+{
+	const u32 alignedSize = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if(alignedSize < size || alignedSize > arena->size - arena->used) return NULL;
+
+	void *const ptr = &arena->mem[arena->used];
+	arena->used += alignedSize;
+	if(arena->used > arena->peak) arena->peak = arena->used;
+
+	return ptr;
+}
+
+void* arenaCalloc(Arena *const arena, const u32 size)
+{
+	void *const ptr = arenaAlloc(arena, size);
+	if(ptr != NULL) memset(ptr, 0, size);
+
+	return ptr;
+}
+
+char* arenaStrdup(Arena *const arena, const char *const str)
+{
+	const u32 len = strlen(str) + 1;
+	char *const copy = (char*)arenaAlloc(arena, len);
+	if(copy != NULL) memcpy(copy, str, len);
+
+	return copy;
+}
+
+void arenaReset(Arena *const arena, const ArenaMark mark)
+{
+	if(mark < arena->used) arena->used = mark;
+}
+
+void arenaRelease(Arena *const arena)
+{
+	free(arena->mem);
+	arena->mem  = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
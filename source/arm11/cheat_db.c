@@ -0,0 +1,115 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "arm11/arena.h"
+#include "arm11/cheat_db.h"
+
+
+static Result readEntries(FHandle f, const u32 first, CheatDbEntry *const entries, const u32 num)
+{
+	Result res = fLseek(f, sizeof(CheatDbHeader) + first * sizeof(CheatDbEntry));
+	if(res != RES_OK) return res;
+
+	u32 read;
+	res = fRead(f, entries, sizeof(CheatDbEntry) * num, &read);
+	if(res == RES_OK && read != sizeof(CheatDbEntry) * num) res = RES_INVALID_ARG;
+
+	return res;
+}
+
+Result cheatDbFind(const char *const path, u32 gameCode, CheatDbMatch *const match, Arena *const arena)
+{
+	FHandle f;
+	Result res;
+	if((res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ)) != RES_OK) return res;
+
+	do
+	{
+		const u32 fileSize = fSize(f);
+		CheatDbHeader hdr;
+		if((res = fRead(f, &hdr, sizeof(hdr), NULL)) != RES_OK) break;
+		if(hdr.magic != CHEAT_DB_MAGIC || hdr.version != CHEAT_DB_VERSION || hdr.numEntries > CHEAT_DB_MAX_ENTRIES ||
+		   sizeof(hdr) + hdr.numEntries * sizeof(CheatDbEntry) > fileSize)
+		{
+			res = RES_INVALID_ARG;
+			break;
+		}
+
+		// First entry with the game code. About 13 reads of 16 bytes
+		// for the biggest index instead of loading all of it.
+		u32 l = 0;
+		u32 r = hdr.numEntries;
+		while(l < r)
+		{
+			const u32 mid = l + (r - l) / 2;
+			CheatDbEntry entry;
+			if((res = readEntries(f, mid, &entry, 1)) != RES_OK) break;
+			if(entry.gameCode < gameCode) l = mid + 1;
+			else                          r = mid;
+		}
+		if(res != RES_OK) break;
+
+		const u32 maxNum = (hdr.numEntries - l < CHEAT_DB_MAX_MATCHES ? hdr.numEntries - l : CHEAT_DB_MAX_MATCHES);
+		if(maxNum == 0) { res = RES_NOT_FOUND; break; }
+		CheatDbEntry *const entries = (CheatDbEntry*)arenaAlloc(arena, sizeof(CheatDbEntry) * maxNum);
+		if(entries == NULL) { res = RES_OUT_OF_MEM; break; }
+		if((res = readEntries(f, l, entries, maxNum)) != RES_OK) break;
+
+		u32 num = 0;
+		while(num < maxNum && entries[num].gameCode == gameCode) num++;
+		if(num == 0) { res = RES_NOT_FOUND; break; }
+
+		// The cheats of all matching entries are contiguous.
+		const u32 start = entries[0].offset;
+		const u32 size = entries[num - 1].offset + entries[num - 1].size - start;
+		if(start > fileSize || size > fileSize - start || size > CHEAT_DB_MAX_CHEATS)
+		{
+			res = RES_INVALID_ARG;
+			break;
+		}
+		for(u32 i = 0; i < num; i++)
+		{
+			if(entries[i].offset < start || entries[i].offset + entries[i].size > start + size || entries[i].size == 0)
+			{
+				res = RES_INVALID_ARG;
+				break;
+			}
+		}
+		if(res != RES_OK) break;
+
+		char *const data = (char*)arenaAlloc(arena, size);
+		if(data == NULL) { res = RES_OUT_OF_MEM; break; }
+		if((res = fLseek(f, start)) != RES_OK || (res = fRead(f, data, size, NULL)) != RES_OK) break;
+		for(u32 i = 0; i < num; i++)
+		{
+			if(data[entries[i].offset - start + entries[i].size - 1] != '\0') res = RES_INVALID_ARG;
+		}
+		if(res != RES_OK) break;
+
+		match->entries = entries;
+		match->num = num;
+		match->data = data;
+	} while(0);
+
+	fClose(f);
+
+	return res;
+}
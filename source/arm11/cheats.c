@@ -0,0 +1,467 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "util.h"
+#include "drivers/lgy.h"
+#include "inih/ini.h"
+#include "arm11/arena.h"
+#include "arm11/cheat_db.h"
+#include "arm11/rom_info.h"
+#include "arm11/fmt.h"
+#include "arm11/sd_writer.h"
+#include "arm11/cheats.h"
+
+
+#define MAX_PATH_SIZE    (512u)
+#define CHEAT_NAME_LEN   (64u)
+#define MAX_WRITE_BYTES  (CHEAT_MAX_WRITES * 4)
+#define MAX_CACHE_SIZE   (sizeof(CheatCacheHeader) + (sizeof(CheatExtent) + 1) * MAX_WRITE_BYTES)
+
+
+typedef struct
+{
+	u32 offset;
+	u32 value;
+	u8 size;   // 1, 2 or 4 bytes.
+	u8 cheat;
+} CheatWrite;
+
+typedef struct
+{
+	u32 offset;
+	u16 seq;   // Later writes to the same byte win.
+	u8 byte;
+} CheatByte;
+
+typedef struct
+{
+	CheatWrite *writes;
+	u32 numWrites;
+	u32 numCheats;
+	u32 lastCheat;                  // Most lines belong to the previous cheat.
+	char names[CHEAT_MAX_CHEATS][CHEAT_NAME_LEN];
+	bool enabled[CHEAT_MAX_CHEATS];
+	bool invalid[CHEAT_MAX_CHEATS]; // Has unsupported codes.
+} CheatParser;
+
+
+// Parses exactly digits hex digits.
+static bool parseHex(const char *str, u32 digits, u32 *const out)
+{
+	u32 val = 0;
+	for(u32 i = 0; i < digits; i++)
+	{
+		const char c = str[i];
+		u32 nibble;
+		if(c >= '0' && c <= '9')      nibble = c - '0';
+		else if(c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+		else if(c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+		else return false;
+
+		val = val<<4 | nibble;
+	}
+
+	*out = val;
+	return true;
+}
+
+static bool parseCode(const char *const code, CheatWrite *const w)
+{
+	const u32 len = strlen(code);
+	u32 addr, val;
+	if(!parseHex(code, 8, &addr)) return false;
+
+	if(code[8] == ':') // Raw ROM write.
+	{
+		const u32 digits = len - 9;
+		if((digits != 2 && digits != 4 && digits != 8) || !parseHex(&code[9], digits, &val)) return false;
+		if(addr < 0x08000000u || addr >= 0x08000000u + MAX_ROM_SIZE) return false;
+
+		w->offset = addr - 0x08000000u;
+		w->size = digits / 2;
+	}
+	else if(code[8] == ' ' && len == 17 && code[0] == '6') // GameShark v1/v2 ROM patch.
+	{
+		if(!parseHex(&code[9], 8, &val) || (val & 0xCFFF0000u) != 0) return false;
+
+		w->offset = (addr & 0x0FFFFFFFu) * 2;
+		w->size = 2;
+		val &= 0xFFFFu;
+		if(w->offset >= MAX_ROM_SIZE) return false;
+	}
+	else return false;
+
+	if(w->offset + w->size > MAX_ROM_SIZE) return false;
+	w->value = val;
+
+	return true;
+}
+
+static int cheatIniCallback(void* user, const char* section, const char* name, const char* value)
+{
+	CheatParser *const p = (CheatParser*)user;
+
+	// Sections with the same name are the same cheat. This way the
+	// cheat file can enable or disable database cheats.
+	u32 cheat = p->lastCheat;
+	if(p->numCheats == 0 || strncmp(section, p->names[cheat], CHEAT_NAME_LEN - 1) != 0)
+	{
+		for(cheat = 0; cheat < p->numCheats; cheat++)
+		{
+			if(strncmp(section, p->names[cheat], CHEAT_NAME_LEN - 1) == 0) break;
+		}
+
+		if(cheat == p->numCheats)
+		{
+			if(p->numCheats == CHEAT_MAX_CHEATS) return 1;
+			safeStrcpy(p->names[cheat], section, CHEAT_NAME_LEN);
+			p->numCheats++;
+		}
+		p->lastCheat = cheat;
+	}
+
+	if(strcmp(name, "enabled") == 0)
+		p->enabled[cheat] = (strcmp(value, "true") == 0 ? true : false);
+	else if(strcmp(name, "code") == 0)
+	{
+		if(p->numWrites == CHEAT_MAX_WRITES) return 1;
+
+		CheatWrite *const w = &p->writes[p->numWrites];
+		if(parseCode(value, w))
+		{
+			w->cheat = cheat;
+			p->numWrites++;
+		}
+		else
+		{
+			debug_printf("Unsupported cheat code in [%s]: %s\n", section, value);
+			p->invalid[cheat] = true;
+		}
+	}
+
+	return 1;
+}
+
+static int cheatByteCompare(const void *a, const void *b)
+{
+	const CheatByte *const ba = (const CheatByte*)a;
+	const CheatByte *const bb = (const CheatByte*)b;
+
+	if(ba->offset != bb->offset) return (ba->offset < bb->offset ? -1 : 1);
+	return (int)ba->seq - (int)bb->seq;
+}
+
+// Compiles the writes of enabled cheats into a cache (header + extents + data).
+static CheatCacheHeader* compileCheats(const CheatParser *const p, const CheatCacheHeader *const key, u32 *const cacheSize,
+                                       Arena *const arena)
+{
+	// Split into bytes and sort by offset. Overlapping writes are resolved in file order.
+	CheatByte *const bytes = (CheatByte*)arenaAlloc(arena, sizeof(CheatByte) * MAX_WRITE_BYTES);
+	if(bytes == NULL) return NULL;
+
+	u32 numBytes = 0;
+	for(u32 i = 0; i < p->numWrites; i++)
+	{
+		const CheatWrite *const w = &p->writes[i];
+		if(!p->enabled[w->cheat] || p->invalid[w->cheat]) continue;
+
+		for(u32 b = 0; b < w->size; b++)
+		{
+			bytes[numBytes].offset = w->offset + b;
+			bytes[numBytes].seq = numBytes;
+			bytes[numBytes].byte = w->value>>(b * 8);
+			numBytes++;
+		}
+	}
+	qsort(bytes, numBytes, sizeof(CheatByte), cheatByteCompare);
+
+	// Drop overwritten bytes and count extents.
+	u32 numUnique = 0;
+	u32 numExtents = 0;
+	for(u32 i = 0; i < numBytes; i++)
+	{
+		if(i + 1 < numBytes && bytes[i + 1].offset == bytes[i].offset) continue;
+
+		if(numUnique == 0 || bytes[numUnique - 1].offset + 1 != bytes[i].offset) numExtents++;
+		bytes[numUnique++] = bytes[i];
+	}
+
+	const u32 size = sizeof(CheatCacheHeader) + sizeof(CheatExtent) * numExtents + numUnique;
+	CheatCacheHeader *const hdr = (CheatCacheHeader*)arenaAlloc(arena, size);
+	if(hdr == NULL) return NULL;
+
+	*hdr = *key;
+	hdr->numExtents = numExtents;
+	hdr->dataSize = numUnique;
+
+	CheatExtent *const extents = (CheatExtent*)(hdr + 1);
+	u8 *const data = (u8*)&extents[numExtents];
+	s32 ext = -1;
+	for(u32 i = 0; i < numUnique; i++)
+	{
+		if(ext < 0 || extents[ext].offset + extents[ext].size != bytes[i].offset)
+		{
+			ext++;
+			extents[ext].offset = bytes[i].offset;
+			extents[ext].size = 0;
+		}
+		extents[ext].size++;
+		data[i] = bytes[i].byte;
+	}
+
+	*cacheSize = size;
+
+	return hdr;
+}
+
+static bool cacheValid(const CheatCacheHeader *const hdr, const u32 size, const CheatCacheHeader *const key)
+{
+	if(size < sizeof(CheatCacheHeader) || hdr->magic != key->magic || hdr->version != key->version ||
+	   hdr->romSize != key->romSize || hdr->rom.size != key->rom.size ||
+	   hdr->rom.fdate != key->rom.fdate || hdr->rom.ftime != key->rom.ftime ||
+	   hdr->chtSize != key->chtSize ||
+	   hdr->chtFdate != key->chtFdate || hdr->chtFtime != key->chtFtime || hdr->dbSize != key->dbSize ||
+	   hdr->dbFdate != key->dbFdate || hdr->dbFtime != key->dbFtime) return false;
+
+	return hdr->numExtents <= MAX_WRITE_BYTES && hdr->dataSize <= MAX_WRITE_BYTES &&
+	       size == sizeof(CheatCacheHeader) + sizeof(CheatExtent) * hdr->numExtents + hdr->dataSize;
+}
+
+// The cache stays allocated in arena on success only.
+static Result loadCache(const char *const path, const CheatCacheHeader *const key, CheatCacheHeader **const out,
+                        Arena *const arena)
+{
+	FHandle f;
+	Result res;
+	if((res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ)) != RES_OK) return res;
+
+	const ArenaMark mark = arenaMark(arena);
+	const u32 size = fSize(f);
+	CheatCacheHeader *const hdr = (size <= MAX_CACHE_SIZE ? (CheatCacheHeader*)arenaAlloc(arena, size) : NULL);
+	if(hdr != NULL)
+	{
+		u32 read;
+		if((res = fRead(f, hdr, size, &read)) == RES_OK && (read != size || !cacheValid(hdr, size, key)))
+			res = RES_NOT_FOUND;
+	}
+	else res = RES_OUT_OF_MEM;
+
+	fClose(f);
+
+	if(res == RES_OK) *out = hdr;
+	else              arenaReset(arena, mark);
+
+	return res;
+}
+
+// Parses the database cheats for the game. Cheats for a specific
+// revision are only used if the CRC32 of the unpatched ROM matches.
+static Result parseCheatDb(const RomInfo *const rom, CheatParser *const p, Arena *const arena)
+{
+	CheatDbMatch match;
+	const Result res = cheatDbFind(CHEAT_DB_PATH, *(u32*)(ROM_LOC + 0xAC), &match, arena);
+	if(res != RES_OK) return res;
+
+	for(u32 i = 0; i < match.num; i++)
+	{
+		const CheatDbEntry *const e = &match.entries[i];
+		if(e->romCrc != 0 && (!rom->crcValid || e->romCrc != rom->crc)) continue;
+
+		ini_parse_string(match.data + (e->offset - match.entries[0].offset), cheatIniCallback, p);
+	}
+
+	return RES_OK;
+}
+
+static Result parseCheatFile(const char *const path, const u32 fileSize, CheatParser *const p, Arena *const arena)
+{
+	if(fileSize >= CHEAT_FILE_MAX) return RES_OUT_OF_MEM;
+
+	char *const buf = (char*)arenaAlloc(arena, fileSize + 1);
+	if(buf == NULL) return RES_OUT_OF_MEM;
+
+	const Result res = fsQuickRead(path, buf, fileSize);
+	if(res != RES_OK) return res;
+	buf[fileSize] = '\0';
+
+	ini_parse_string(buf, cheatIniCallback, p);
+
+	return RES_OK;
+}
+
+static void applyExtents(const CheatCacheHeader *const hdr, const u32 romSize)
+{
+	const CheatExtent *const extents = (const CheatExtent*)(hdr + 1);
+	const u8 *data = (const u8*)&extents[hdr->numExtents];
+	for(u32 i = 0; i < hdr->numExtents; i++)
+	{
+		const CheatExtent *const e = &extents[i];
+		if(e->offset + e->size <= romSize) memcpy((u8*)ROM_LOC + e->offset, data, e->size);
+		else debug_printf("Cheat write at 0x%lX is outside of the ROM.\n", e->offset);
+
+		data += e->size;
+	}
+}
+
+// Makes "cheats/<ROM name><ext>".
+static bool makeCheatPath(const char *const romPath, const char *const ext, char out[MAX_PATH_SIZE])
+{
+	const char *name = strrchr(romPath, '/');
+	name = (name != NULL ? name + 1 : romPath);
+	const u32 nameLen = strlen(name);
+	if(nameLen < 4 || sizeof(CHEATS_DIR "/") + nameLen - 4 + strlen(ext) > MAX_PATH_SIZE) return false;
+
+	strcpy(out, CHEATS_DIR "/");
+	strncat(out, name, nameLen - 4); // Without ".gba".
+	strcat(out, ext);
+
+	return true;
+}
+
+// True if the database has cheats for a specific revision of the game.
+static bool hasRevisionCheats(Arena *const arena)
+{
+	const ArenaMark mark = arenaMark(arena);
+	CheatDbMatch match;
+	bool found = false;
+	if(cheatDbFind(CHEAT_DB_PATH, *(u32*)(ROM_LOC + 0xAC), &match, arena) == RES_OK)
+	{
+		for(u32 i = 0; i < match.num; i++)
+		{
+			if(match.entries[i].romCrc != 0) { found = true; break; }
+		}
+	}
+	arenaReset(arena, mark);
+
+	return found;
+}
+
+Result cheatsPrepare(const char *const romPath, RomInfo *const rom, Arena *const arena)
+{
+	// Already calculated for the patches.
+	if(rom->crcValid) return RES_OK;
+
+	// Only database cheats need the CRC32.
+	FILINFO fi;
+	if(fStat(CHEAT_DB_PATH, &fi) != RES_OK) return RES_OK;
+
+	const ArenaMark mark = arenaMark(arena);
+	char *const cachePath = (char*)arenaAlloc(arena, MAX_PATH_SIZE);
+	Result res = RES_OK;
+	do
+	{
+		if(cachePath == NULL) { res = RES_OUT_OF_MEM; break; }
+		if(!makeCheatPath(romPath, ".chc", cachePath)) { res = RES_INVALID_ARG; break; }
+
+		// Reuse the CRC32 from the cache if the ROM file didn't change.
+		CheatCacheHeader cached;
+		FHandle f;
+		if(fOpen(&f, cachePath, FA_OPEN_EXISTING | FA_READ) == RES_OK)
+		{
+			u32 read;
+			if(fRead(f, &cached, sizeof(cached), &read) == RES_OK && read == sizeof(cached) &&
+			   cached.magic == CHEAT_CACHE_MAGIC && cached.version == CHEAT_CACHE_VERSION)
+			{
+				romInfoAdopt(rom, &cached.rom);
+			}
+			fClose(f);
+		}
+
+		if(!rom->crcValid && hasRevisionCheats(arena)) romInfoCrc(rom);
+	} while(0);
+
+	arenaReset(arena, mark);
+
+	return res;
+}
+
+Result cheatsApply(const char *const romPath, const u32 romSize, const RomInfo *const rom,
+                   Arena *const arena)
+{
+	const ArenaMark mark = arenaMark(arena);
+	char *const chtPath = (char*)arenaAlloc(arena, MAX_PATH_SIZE);
+	char *const cachePath = (char*)arenaAlloc(arena, MAX_PATH_SIZE);
+	CheatParser *const parser = (CheatParser*)arenaCalloc(arena, sizeof(CheatParser));
+	Result res;
+	do
+	{
+		if(chtPath == NULL || cachePath == NULL || parser == NULL) { res = RES_OUT_OF_MEM; break; }
+		if(!makeCheatPath(romPath, ".cht", chtPath) || !makeCheatPath(romPath, ".chc", cachePath))
+		{
+			res = RES_INVALID_ARG;
+			break;
+		}
+
+		// Either a cheat file or the database is needed.
+		FILINFO chtFi, dbFi;
+		const bool hasCht = fStat(chtPath, &chtFi) == RES_OK;
+		const bool hasDb = fStat(CHEAT_DB_PATH, &dbFi) == RES_OK;
+		if(!hasCht && !hasDb) { res = RES_FR_NO_FILE; break; }
+		res = RES_OK;
+		if(!hasCht) memset(&chtFi, 0, sizeof(chtFi));
+		if(!hasDb)  memset(&dbFi, 0, sizeof(dbFi));
+
+		const CheatCacheHeader key =
+		{
+			CHEAT_CACHE_MAGIC, CHEAT_CACHE_VERSION, 0,
+			romSize, *rom,
+			chtFi.fsize, chtFi.fdate, chtFi.ftime,
+			dbFi.fsize, dbFi.fdate, dbFi.ftime, 0, 0
+		};
+
+		// Only the cache is read if neither the ROM nor the cheat file or database changed.
+		CheatCacheHeader *hdr = NULL;
+		if(loadCache(cachePath, &key, &hdr, arena) != RES_OK)
+		{
+			if((parser->writes = (CheatWrite*)arenaAlloc(arena, sizeof(CheatWrite) * CHEAT_MAX_WRITES)) == NULL)
+			{
+				res = RES_OUT_OF_MEM;
+				break;
+			}
+
+			// Database first so the cheat file can override it.
+			if(hasDb)
+			{
+				const Result dbRes = parseCheatDb(rom, parser, arena);
+				if(dbRes != RES_OK && dbRes != RES_NOT_FOUND) debug_printf("Cheat database unusable: %s\n", result2String(dbRes));
+			}
+			if(hasCht && (res = parseCheatFile(chtPath, chtFi.fsize, parser, arena)) != RES_OK) break;
+
+			u32 cacheSize;
+			if((hdr = compileCheats(parser, &key, &cacheSize, arena)) == NULL) { res = RES_OUT_OF_MEM; break; }
+
+			// Not fatal. The cheats are parsed again next time.
+			if(!hasCht) fMkdir(CHEATS_DIR);
+			if(sdWriteAsyncCopy(cachePath, hdr, cacheSize, SD_WRITE_PRIO_NORMAL) != RES_OK)
+				debug_printf("Failed to write %s\n", cachePath);
+		}
+
+		applyExtents(hdr, romSize);
+		debug_printf("Cheats: %lu extents, %lu bytes\n", hdr->numExtents, hdr->dataSize);
+	} while(0);
+
+	arenaReset(arena, mark);
+
+	return res;
+}
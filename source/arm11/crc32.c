@@ -0,0 +1,80 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/crc32.h"
+
+
+// Slicing-by-4. 4 table lookups per word instead of per byte.
+static u32 g_crcTable[4][256];
+static bool g_crcTableReady = false;
+
+
+static void makeTables(void)
+{
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 c = i;
+		for(u32 k = 0; k < 8; k++) c = (c & 1u ? 0xEDB88320u ^ (c>>1) : c>>1);
+		g_crcTable[0][i] = c;
+	}
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 c = g_crcTable[0][i];
+		for(u32 t = 1; t < 4; t++)
+		{
+			c = g_crcTable[0][c & 0xFFu] ^ (c>>8);
+			g_crcTable[t][i] = c;
+		}
+	}
+
+	g_crcTableReady = true;
+}
+
+u32 crc32(u32 crc, const void *data, u32 size)
+{
+	if(!g_crcTableReady) makeTables();
+
+	const u8 *p = (const u8*)data;
+	crc = ~crc;
+
+	// Bytes up to the first aligned word.
+	while(size > 0 && ((uintptr_t)p & 3u) != 0)
+	{
+		crc = g_crcTable[0][(crc ^ *p++) & 0xFFu] ^ (crc>>8);
+		size--;
+	}
+
+	const u32 *w = (const u32*)p;
+	for(; size >= 4; size -= 4)
+	{
+		crc ^= *w++; // Little endian.
+		crc = g_crcTable[3][crc & 0xFFu] ^ g_crcTable[2][(crc>>8) & 0xFFu] ^
+		      g_crcTable[1][(crc>>16) & 0xFFu] ^ g_crcTable[0][crc>>24];
+	}
+
+	p = (const u8*)w;
+	while(size > 0)
+	{
+		crc = g_crcTable[0][(crc ^ *p++) & 0xFFu] ^ (crc>>8);
+		size--;
+	}
+
+	return ~crc;
+}
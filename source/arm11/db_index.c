@@ -0,0 +1,154 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "arm11/fmt.h"
+#include "arm11/db_index.h"
+
+
+#define BUILD_CHUNK  (1024u * 8)
+
+
+static bool headerMatches(const DbIndexHeader *const hdr, const DbIndexHeader *const expected)
+{
+	return hdr->magic == expected->magic && hdr->version == expected->version &&
+	       hdr->keyOffset == expected->keyOffset && hdr->entrySize == expected->entrySize &&
+	       hdr->dbSize == expected->dbSize && hdr->dbFdate == expected->dbFdate &&
+	       hdr->dbFtime == expected->dbFtime && hdr->num == expected->num;
+}
+
+// Returns the index (header + keys) or NULL.
+static DbIndexHeader* loadIndex(const char *const idxPath, const DbIndexHeader *const expected)
+{
+	const u32 size = sizeof(DbIndexHeader) + expected->num * sizeof(u64);
+	DbIndexHeader *const idx = (DbIndexHeader*)malloc(size);
+	if(idx == NULL) return NULL;
+
+	FHandle f;
+	bool ok = false;
+	if(fOpen(&f, idxPath, FA_OPEN_EXISTING | FA_READ) == RES_OK)
+	{
+		u32 read;
+		ok = fSize(f) == size && fRead(f, idx, size, &read) == RES_OK && read == size && headerMatches(idx, expected);
+		fClose(f);
+	}
+
+	if(!ok)
+	{
+		free(idx);
+		return NULL;
+	}
+
+	return idx;
+}
+
+static DbIndexHeader* buildIndex(const char *const dbPath, const char *const idxPath, const DbIndexHeader *const expected)
+{
+	const u32 size = sizeof(DbIndexHeader) + expected->num * sizeof(u64);
+	DbIndexHeader *const idx = (DbIndexHeader*)malloc(size);
+	u8 *const buf = (u8*)malloc(BUILD_CHUNK);
+	if(idx == NULL || buf == NULL)
+	{
+		free(buf);
+		free(idx);
+		return NULL;
+	}
+
+	FHandle f;
+	Result res;
+	if((res = fOpen(&f, dbPath, FA_OPEN_EXISTING | FA_READ)) == RES_OK)
+	{
+		// Read whole chunks of entries sequentially.
+		const u32 entrySize = expected->entrySize;
+		const u32 perChunk = BUILD_CHUNK / entrySize;
+		u64 *const keys = (u64*)(idx + 1);
+		for(u32 i = 0; i < expected->num; i += perChunk)
+		{
+			const u32 n = (expected->num - i < perChunk ? expected->num - i : perChunk);
+			if((res = fRead(f, buf, n * entrySize, NULL)) != RES_OK) break;
+
+			for(u32 j = 0; j < n; j++) memcpy(&keys[i + j], &buf[j * entrySize + expected->keyOffset], sizeof(u64));
+		}
+
+		fClose(f);
+	}
+	free(buf);
+
+	if(res != RES_OK)
+	{
+		free(idx);
+		return NULL;
+	}
+
+	*idx = *expected;
+
+	// Not fatal. It's built again next time.
+	res = fsQuickWrite(idxPath, idx, size);
+	debug_printf("Built %s (%lu entries): %s\n", idxPath, expected->num, result2String(res));
+
+	return idx;
+}
+
+Result dbIndexFind(const char *const dbPath, const char *const idxPath, u32 entrySize, u16 keyOffset,
+                   u64 key, s32 *const entryPos)
+{
+	if(entrySize == 0 || entrySize > BUILD_CHUNK || keyOffset + sizeof(u64) > entrySize) return RES_INVALID_ARG;
+
+	FILINFO fi;
+	Result res = fStat(dbPath, &fi);
+	if(res != RES_OK) return res;
+
+	const DbIndexHeader expected =
+	{
+		DB_INDEX_MAGIC, DB_INDEX_VERSION, keyOffset, entrySize,
+		fi.fsize, fi.fdate, fi.ftime, fi.fsize / entrySize
+	};
+	if(expected.num == 0) return RES_NOT_FOUND;
+
+	DbIndexHeader *idx = loadIndex(idxPath, &expected);
+	if(idx == NULL) idx = buildIndex(dbPath, idxPath, &expected);
+	if(idx == NULL) return RES_OUT_OF_MEM;
+
+	// Same search as on the file. Keys are compared as loaded from the file.
+	const u64 *const keys = (const u64*)(idx + 1);
+	s32 l = 0;
+	s32 r = expected.num - 1;
+	res = RES_NOT_FOUND;
+	while(l <= r)
+	{
+		const s32 mid = l + (r - l) / 2;
+		if(keys[mid] == key)
+		{
+			*entryPos = mid;
+			res = RES_OK;
+			break;
+		}
+
+		if(keys[mid] > key) r = mid - 1;
+		else                l = mid + 1;
+	}
+
+	free(idx);
+
+	return res;
+}
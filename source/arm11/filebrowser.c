@@ -24,8 +24,9 @@
 #include "util.h"
 #include "arm11/drivers/hid.h"
 #include "arm11/fmt.h"
-#include "drivers/gfx.h"
+#include "arm11/arena.h"
 #include "arm11/filebrowser.h"
+#include "arm11/ui_input.h"
 
 
 int dlistCompare(const void *a, const void *b)
@@ -46,9 +47,10 @@ int dlistCompare(const void *a, const void *b)
 	return res;
 }
 
-Result scanDir(const char *const path, DirList *const dList, const char *const filter)
+static Result scanDir(const char *const path, DirList *const dList, const char *const filter, Arena *const arena)
 {
-	FILINFO *const fis = (FILINFO*)malloc(sizeof(FILINFO) * DIR_READ_BLOCKS);
+	const ArenaMark mark = arenaMark(arena);
+	FILINFO *const fis = (FILINFO*)arenaAlloc(arena, sizeof(FILINFO) * DIR_READ_BLOCKS);
 	if(fis == NULL) return RES_OUT_OF_MEM;
 
 	dList->num = 0;
@@ -93,19 +95,19 @@ scanEnd:
 		fCloseDir(dh);
 	}
 
-	free(fis);
+	arenaReset(arena, mark);
 
 	qsort(dList->ptrs, dList->num, sizeof(char*), dlistCompare);
 
 	return res;
 }
 
-void showDirList(const DirList *const dList, u32 start)
+void showDirListRows(const DirList *const dList, u32 start, u32 rows)
 {
 	// Clear screen.
 	ee_printf("\x1b[2J");
 
-	const u32 listLength = (dList->num - start > SCREEN_ROWS ? start + SCREEN_ROWS : dList->num);
+	const u32 listLength = (dList->num - start > rows ? start + rows : dList->num);
 	for(u32 i = start; i < listLength; i++)
 	{
 		const char *const printStr =
@@ -115,20 +117,29 @@ void showDirList(const DirList *const dList, u32 start)
 	}
 }
 
-Result browseFiles(const char *const basePath, char selected[512])
+void showDirList(const DirList *const dList, u32 start)
 {
-	if(basePath == NULL || selected == NULL) return RES_INVALID_ARG;
+	showDirListRows(dList, start, SCREEN_ROWS);
+}
+
+Result browseFiles(const char *const basePath, char selected[512], Arena *const arena)
+{
+	if(basePath == NULL || selected == NULL || arena == NULL) return RES_INVALID_ARG;
 	// TODO: Check if the base path is empty.
 
-	char *curDir = (char*)malloc(512);
-	if(curDir == NULL) return RES_OUT_OF_MEM;
+	// Everything below is dropped at once on return.
+	const ArenaMark mark = arenaMark(arena);
+	Result res;
+	char *const curDir = (char*)arenaAlloc(arena, 512);
+	DirList *const dList = (DirList*)arenaAlloc(arena, sizeof(DirList));
+	if(curDir == NULL || dList == NULL)
+	{
+		res = RES_OUT_OF_MEM;
+		goto end;
+	}
 	safeStrcpy(curDir, basePath, 512);
 
-	DirList *const dList = (DirList*)malloc(sizeof(DirList));
-	if(dList == NULL) return RES_OUT_OF_MEM;
-
-	Result res;
-	if((res = scanDir(curDir, dList, ".gba")) != RES_OK) goto end;
+	if((res = scanDir(curDir, dList, ".gba", arena)) != RES_OK) goto end;
 	showDirList(dList, 0);
 
 	s32 cursorPos = 0; // Within the entire list.
@@ -140,14 +151,7 @@ Result browseFiles(const char *const basePath, char selected[512])
 		ee_printf("\x1b[%lu;H\x1b[37m>", cursorPos - windowPos); // Draw cursor.
 
 		u32 kDown;
-		do
-		{
-			GFX_waitForVBlank0();
-
-			hidScanInput();
-			if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) goto end;
-			kDown = hidKeysDown();
-		} while(kDown == 0);
+		if(!uiWaitForKeys(&kDown)) goto end;
 
 		const u32 num = dList->num;
 		if(num != 0)
@@ -205,7 +209,7 @@ Result browseFiles(const char *const basePath, char selected[512])
 				*tmpPathPtr = '\0';
 			}
 
-			if((res = scanDir(curDir, dList, ".gba")) != RES_OK) break;
+			if((res = scanDir(curDir, dList, ".gba", arena)) != RES_OK) break;
 			cursorPos = 0;
 			windowPos = 0;
 			showDirList(dList, 0);
@@ -213,8 +217,7 @@ Result browseFiles(const char *const basePath, char selected[512])
 	}
 
 end:
-	free(dList);
-	free(curDir);
+	arenaReset(arena, mark);
 
 	// Clear screen.
 	ee_printf("\x1b[2J");
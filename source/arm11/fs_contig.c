@@ -0,0 +1,48 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "arm11/fmt.h"
+#include "arm11/fs_contig.h"
+
+
+
+Result fsQuickWriteContig(const char *const path, const void *const buf, u32 size)
+{
+	if(size < CONTIG_MIN_SIZE) return fsQuickWrite(path, buf, size);
+
+	FHandle f;
+	Result res = fOpen(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res != RES_OK) return res;
+
+	// Only works on empty files. The file size is already set
+	// to size afterwards and writing starts at 0.
+	if(fExpand(f, size) != RES_OK)
+		debug_printf("No contiguous space for %s. Writing fragmented.\n", path);
+
+	u32 written;
+	res = fWrite(f, buf, size, &written);
+	if(res == RES_OK && written != size) res = RES_FR_DENIED; // Disk full.
+
+	const Result closeRes = fClose(f);
+
+	return (res == RES_OK ? closeRes : res);
+}
@@ -0,0 +1,240 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Debug builds only. arm11/heap_prof_hooks.h redirects malloc(), calloc(),
+// realloc() and free() calls to the functions below.
+#ifndef NDEBUG
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fsutil.h"
+#include "kmutex.h"
+#include "arm11/heap_profile.h"
+#include "arm11/heap_prof_hooks.h"
+
+// The hooks call the real functions (the libn3ds debug wrappers).
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+
+#define MAX_SITES  (128u)  // Must be a power of 2.
+#define MAX_LIVE   (1024u) // Must be a power of 2.
+
+
+typedef struct
+{
+	void *ptr;
+	u32 size;
+	u32 site;      // Index into g_sites.
+} LiveAlloc;
+
+static HeapProfHeader g_hdr = {HEAP_PROF_MAGIC, HEAP_PROF_VERSION, 0, 0, 0, 0, 0, 0, 0};
+static HeapProfSite g_sites[MAX_SITES];
+static LiveAlloc g_live[MAX_LIVE]; // Open addressing. ptr NULL = empty.
+static u32 g_numLive = 0;          // At least 1 entry is always empty.
+static KHandle g_mutex = 0;        // 0 until heapProfInit(). Only 1 task runs before.
+
+
+static inline u32 hashPtr(const void *const ptr)
+{
+	// Knuth multiplicative hash. Low bits are always 0 (alignment).
+	return ((uintptr_t)ptr >> 3) * 2654435761u;
+}
+
+static u32 getSite(const u32 callSite)
+{
+	u32 i = hashPtr((void*)callSite) & (MAX_SITES - 1);
+	for(u32 n = 0; n < MAX_SITES; n++, i = (i + 1) & (MAX_SITES - 1))
+	{
+		if(g_sites[i].callSite == callSite) return i;
+		if(g_sites[i].callSite == 0)
+		{
+			g_sites[i].callSite = callSite;
+			g_hdr.numSites++;
+			return i;
+		}
+	}
+
+	return MAX_SITES;
+}
+
+static void recordAlloc(void *const ptr, const u32 size, const u32 callSite)
+{
+	if(ptr == NULL)
+	{
+		g_hdr.failedAllocs++;
+		return;
+	}
+
+	g_hdr.totalAllocs++;
+	g_hdr.totalBytes += size;
+	g_hdr.liveBytes += size;
+	if(g_hdr.liveBytes > g_hdr.peakLiveBytes) g_hdr.peakLiveBytes = g_hdr.liveBytes;
+
+	const u32 site = getSite(callSite);
+	if(site < MAX_SITES)
+	{
+		HeapProfSite *const s = &g_sites[site];
+		s->allocs++;
+		s->totalBytes += size;
+		s->liveCount++;
+		s->liveBytes += size;
+		if(s->liveBytes > s->peakLiveBytes) s->peakLiveBytes = s->liveBytes;
+	}
+
+	if(g_numLive == MAX_LIVE - 1)
+	{
+		// Table full. We can't account the free() for this one.
+		g_hdr.untracked++;
+		return;
+	}
+
+	u32 i = hashPtr(ptr) & (MAX_LIVE - 1);
+	while(g_live[i].ptr != NULL) i = (i + 1) & (MAX_LIVE - 1);
+	g_live[i] = (LiveAlloc){ptr, size, site};
+	g_numLive++;
+}
+
+static void recordFree(void *const ptr)
+{
+	for(u32 i = hashPtr(ptr) & (MAX_LIVE - 1); g_live[i].ptr != NULL; i = (i + 1) & (MAX_LIVE - 1))
+	{
+		if(g_live[i].ptr != ptr) continue;
+
+		const LiveAlloc alloc = g_live[i];
+		g_hdr.liveBytes -= alloc.size;
+		if(alloc.site < MAX_SITES)
+		{
+			HeapProfSite *const s = &g_sites[alloc.site];
+			s->frees++;
+			s->liveCount--;
+			s->liveBytes -= alloc.size;
+		}
+
+		// Backward shift deletion so lookups never stop early.
+		u32 hole = i;
+		for(u32 j = (i + 1) & (MAX_LIVE - 1); g_live[j].ptr != NULL; j = (j + 1) & (MAX_LIVE - 1))
+		{
+			const u32 home = hashPtr(g_live[j].ptr) & (MAX_LIVE - 1);
+			if(((j - home) & (MAX_LIVE - 1)) >= ((j - hole) & (MAX_LIVE - 1)))
+			{
+				g_live[hole] = g_live[j];
+				hole = j;
+			}
+		}
+		g_live[hole].ptr = NULL;
+		g_numLive--;
+
+		return;
+	}
+
+	// Not allocated through the wrappers or untracked.
+}
+
+static inline void lockProf(void)
+{
+	if(g_mutex != 0) lockMutex(g_mutex);
+}
+
+static inline void unlockProf(void)
+{
+	if(g_mutex != 0) unlockMutex(g_mutex);
+}
+
+void heapProfInit(void)
+{
+	// createMutex() may allocate. Store the handle after it returns
+	// so the nested malloc() doesn't try to lock it.
+	const KHandle mutex = createMutex();
+	g_mutex = mutex;
+}
+
+void* heapProfMalloc(size_t size)
+{
+	void *const ptr = malloc(size);
+	lockProf();
+	recordAlloc(ptr, size, (u32)__builtin_return_address(0));
+	unlockProf();
+
+	return ptr;
+}
+
+void* heapProfCalloc(size_t num, size_t size)
+{
+	void *const ptr = calloc(num, size);
+	lockProf();
+	recordAlloc(ptr, num * size, (u32)__builtin_return_address(0));
+	unlockProf();
+
+	return ptr;
+}
+
+void* heapProfRealloc(void *ptr, size_t size)
+{
+	// The old block is gone on success. On failure it stays allocated.
+	void *const newPtr = realloc(ptr, size);
+	lockProf();
+	if(ptr != NULL && (newPtr != NULL || size == 0)) recordFree(ptr);
+	if(size != 0) recordAlloc(newPtr, size, (u32)__builtin_return_address(0));
+	unlockProf();
+
+	return newPtr;
+}
+
+void heapProfFree(void *ptr)
+{
+	// Untrack before the real free(). Once freed another task can
+	// get the same pointer from malloc() and record it.
+	if(ptr != NULL)
+	{
+		lockProf();
+		recordFree(ptr);
+		unlockProf();
+	}
+	free(ptr);
+}
+
+Result heapProfWriteReport(const char *const path)
+{
+	// Take a snapshot first. Writing the file may allocate.
+	static struct
+	{
+		HeapProfHeader hdr;
+		HeapProfSite sites[MAX_SITES];
+	} report;
+
+	lockProf();
+	u32 num = 0;
+	for(u32 i = 0; i < MAX_SITES; i++)
+	{
+		if(g_sites[i].callSite != 0) report.sites[num++] = g_sites[i];
+	}
+	report.hdr = g_hdr;
+	report.hdr.numSites = num;
+	unlockProf();
+
+	return fsQuickWrite(path, &report, sizeof(HeapProfHeader) + sizeof(HeapProfSite) * num);
+}
+
+#endif // ifndef NDEBUG
@@ -0,0 +1,105 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm_intrinsic.h"
+#include "arm11/drivers/hid.h"
+#include "kernel.h"
+#include "kevent.h"
+#include "arm11/latency.h"
+#include "arm11/input_task.h"
+
+
+// Higher than gbaGfxHandler() (3) so the snapshot is ready before it continues.
+#define INPUT_TASK_PRIO  (4u)
+
+
+static KHandle g_scanEvent = 0;
+
+// Sequence lock. Odd while the snapshot is being written.
+// Readers retry instead of blocking the writer.
+static volatile u32 g_seq = 0;
+static InputSnapshot g_snapshot = {0};
+
+
+static void publish(const u32 held, const u32 down, const u32 up, const u32 extra)
+{
+	g_seq++;
+	__dmb();
+	g_snapshot.held  = held;
+	g_snapshot.down  = down;
+	g_snapshot.up    = up;
+	g_snapshot.extra = extra;
+	g_snapshot.frame++;
+	__dmb();
+	g_seq++;
+}
+
+static void inputTask(void *args)
+{
+	const KHandle event = (KHandle)args;
+
+	while(1)
+	{
+		if(waitForEvent(event) != KRES_OK) break;
+		clearEvent(event);
+
+		hidScanInput();
+		const u32 kDown = hidKeysDown();
+		publish(hidKeysHeld(), kDown, hidKeysUp(), hidGetExtraKeys(0));
+		latencyInput(kDown);
+	}
+
+	taskExit();
+}
+
+void inputTaskInit(void)
+{
+	const KHandle event = createEvent(false);
+	createTask(0x800, INPUT_TASK_PRIO, inputTask, (void*)event);
+	g_scanEvent = event;
+
+	// Valid snapshot before the first frame.
+	inputTaskScan();
+}
+
+void inputTaskScan(void)
+{
+	if(g_scanEvent != 0) signalEvent(g_scanEvent, true);
+}
+
+void inputGetSnapshot(InputSnapshot *const out)
+{
+	u32 seq;
+	do
+	{
+		seq = g_seq;
+		__dmb();
+		*out = g_snapshot;
+		__dmb();
+	} while((seq & 1u) != 0 || seq != g_seq);
+}
+
+void inputTaskDeinit(void)
+{
+	if(g_scanEvent != 0)
+	{
+		deleteEvent(g_scanEvent); // inputTask() will automatically terminate.
+		g_scanEvent = 0;
+	}
+}
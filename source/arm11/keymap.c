@@ -0,0 +1,117 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/keymap.h"
+
+
+typedef struct
+{
+	const char *name;
+	u8 bit;
+} KeyName;
+
+
+// 3DS key bits. The circle pad maps to the D-Pad by default.
+static const KeyName g_3dsKeys[] =
+{
+	{"A", 0}, {"B", 1}, {"SELECT", 2}, {"START", 3}, {"RIGHT", 4}, {"LEFT", 5}, {"UP", 6}, {"DOWN", 7},
+	{"R", 8}, {"L", 9}, {"X", 10}, {"Y", 11}, {"ZL", 14}, {"ZR", 15}, {"TOUCH", 20},
+	{"CSTICK_RIGHT", 24}, {"CSTICK_LEFT", 25}, {"CSTICK_UP", 26}, {"CSTICK_DOWN", 27},
+	{"CPAD_RIGHT", 28}, {"CPAD_LEFT", 29}, {"CPAD_UP", 30}, {"CPAD_DOWN", 31}
+};
+
+// Default mapping. Entries for other keys are 0 (unmapped).
+static u16 g_keyMap[32] =
+{
+	GBA_KEY_A, GBA_KEY_B, GBA_KEY_SELECT, GBA_KEY_START, GBA_KEY_RIGHT, GBA_KEY_LEFT, GBA_KEY_UP, GBA_KEY_DOWN,
+	GBA_KEY_R, GBA_KEY_L, [28] = GBA_KEY_RIGHT, GBA_KEY_LEFT, GBA_KEY_UP, GBA_KEY_DOWN
+};
+
+u16 g_keymapLut[4][256] = {0};
+bool g_keymapActive = false;
+
+
+
+static s8 findKey(const char *const name, const u32 len)
+{
+	for(u32 i = 0; i < sizeof(g_3dsKeys) / sizeof(*g_3dsKeys); i++)
+	{
+		if(strlen(g_3dsKeys[i].name) == len && strncmp(g_3dsKeys[i].name, name, len) == 0)
+			return g_3dsKeys[i].bit;
+	}
+
+	return -1;
+}
+
+s8 keymapKeyBit(const char *const name)
+{
+	return findKey(name, strlen(name));
+}
+
+bool keymapParse(const char *const name, const char *const value)
+{
+	const s8 bit = findKey(name, strlen(name));
+	if(bit < 0) return false;
+
+	// "NONE" unmaps the key.
+	u16 gbaKeys = 0;
+	if(strcmp(value, "NONE") != 0)
+	{
+		const char *str = value;
+		while(1)
+		{
+			const char *const sep = strchr(str, '+');
+			const u32 len = (sep == NULL ? strlen(str) : (u32)(sep - str));
+
+			// The GBA buttons are the first 10 3DS keys.
+			const s8 gbaBit = findKey(str, len);
+			if(gbaBit < 0 || gbaBit > 9) return false;
+			gbaKeys |= 1u<<gbaBit;
+
+			if(sep == NULL) break;
+			str = sep + 1;
+		}
+	}
+
+	g_keyMap[bit] = gbaKeys;
+
+	return true;
+}
+
+void keymapCompile(void)
+{
+	bool active = false;
+	for(u32 bit = 0; bit < 32; bit++)
+	{
+		// The hardware handles A-L and the circle pad (see LGY_handleOverrides()).
+		const u16 hwKeys = (bit < 10 ? 1u<<bit : (bit >= 28 ? GBA_KEY_RIGHT<<(bit - 28) : 0));
+		active |= g_keyMap[bit] != hwKeys;
+	}
+	g_keymapActive = active;
+
+	// Each entry is the entry without the lowest set bit + the mask of that bit.
+	for(u32 byte = 0; byte < 4; byte++)
+	{
+		u16 *const lut = g_keymapLut[byte];
+		lut[0] = 0;
+		for(u32 i = 1; i < 256; i++)
+			lut[i] = lut[i & (i - 1)] | g_keyMap[byte * 8 + __builtin_ctz(i)];
+	}
+}
@@ -0,0 +1,207 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/fmt.h"
+#include "arm11/sd_writer.h"
+#include "arm11/latency.h"
+
+
+#define CHECKSUM_STRIDE  (64u / 4) // Sample 1 word every 64 bytes.
+// The cycle counter runs at the core clock / 64. The core clock is a
+// multiple of the O3DS clock (New 3DS 2x/3x mode). It's measured against
+// the GBA frame rate (16777216 Hz / 280896 cycles) and rounded to the
+// nearest multiple so missed frames don't matter.
+#define BASE_CORE_CLOCK  (268111856u)
+#define MAX_CLOCK_MULT   (3u)
+#define CALIB_FRAMES     (120u)
+#define GBA_CLOCK        (16777216u)
+#define GBA_FRAME_CYCLES (280896u)
+#define REPORT_BUF_SIZE  (1024u * 8)
+
+
+typedef enum
+{
+	STATE_IDLE  = 0u,
+	STATE_PRESS = 1u, // Press scanned. Waiting for the baseline checksum.
+	STATE_WAIT  = 2u  // Waiting for the frame to change.
+} LatencyState;
+
+static u32 g_testKey = 0;
+static volatile u8 g_state = STATE_IDLE;
+static u32 g_pressTick;
+static u32 g_lastSum;     // Checksum of the last frame shown.
+static u32 g_baseline;
+static u32 g_waitFrames;
+static u32 g_calibStart;
+static u32 g_calibFrames = 0;
+static u32 g_ticksPerMs = 0; // 0 until measured.
+static u32 g_numSamples = 0;
+static u32 g_timeouts = 0;
+static u32 g_samples[LATENCY_MAX_SAMPLES]; // In ticks.
+
+
+
+static inline u32 getTicks(void)
+{
+	u32 ticks;
+	__asm__ volatile("mrc p15, 0, %0, c15, c12, 1" : "=r" (ticks) : : "memory");
+	return ticks;
+}
+
+static u32 frameChecksum(const u32 *const frame, const u32 size)
+{
+	u32 sum = 0;
+	for(u32 i = 0; i < size / 4; i += CHECKSUM_STRIDE)
+		sum = (sum<<5 | sum>>27) ^ frame[i];
+
+	return sum;
+}
+
+static void calibrate(void)
+{
+	const u32 now = getTicks();
+	if(g_calibFrames++ == 0)
+	{
+		g_calibStart = now;
+		return;
+	}
+	if(g_calibFrames <= CALIB_FRAMES) return;
+
+	const u64 coreClock = (u64)(now - g_calibStart) * 64 * GBA_CLOCK / ((u64)GBA_FRAME_CYCLES * CALIB_FRAMES);
+	u32 mult = (u32)((coreClock + BASE_CORE_CLOCK / 2) / BASE_CORE_CLOCK);
+	if(mult < 1) mult = 1;
+	if(mult > MAX_CLOCK_MULT) mult = MAX_CLOCK_MULT;
+	g_ticksPerMs = BASE_CORE_CLOCK * mult / 64 / 1000;
+}
+
+void latencyInit(u32 testKey)
+{
+	g_testKey = testKey;
+	if(testKey == 0) return;
+
+	// Enable the cycle counter with the /64 divider (about 4.19 MHz at 268 MHz).
+	// Overflows after a few minutes but only differences are used.
+	__asm__ volatile("mcr p15, 0, %0, c15, c12, 0" : : "r" (1u<<3 | 1u<<2 | 1u) : "memory");
+}
+
+void latencyInput(u32 kDown)
+{
+	if((kDown & g_testKey) == 0 || g_state != STATE_IDLE) return;
+
+	g_pressTick = getTicks();
+	g_state = STATE_PRESS;
+}
+
+void latencyFrame(const u32 *const frame, const u32 size)
+{
+	if(g_testKey == 0) return;
+	if(g_ticksPerMs == 0) calibrate();
+
+	// Every frame so the baseline is a frame shown before the press.
+	const u32 sum = frameChecksum(frame, size);
+	u8 state = g_state;
+	if(state == STATE_PRESS)
+	{
+		// The press was scanned after the last frame was shown.
+		// This frame can already have the change.
+		g_baseline = g_lastSum;
+		g_waitFrames = 0;
+		state = STATE_WAIT;
+	}
+	if(state == STATE_WAIT)
+	{
+		if(sum != g_baseline)
+		{
+			if(g_numSamples < LATENCY_MAX_SAMPLES) g_samples[g_numSamples++] = getTicks() - g_pressTick;
+			state = STATE_IDLE;
+		}
+		else if(++g_waitFrames >= LATENCY_TIMEOUT)
+		{
+			g_timeouts++;
+			state = STATE_IDLE;
+		}
+		g_state = state;
+	}
+	g_lastSum = sum;
+}
+
+static int cmpU32(const void *a, const void *b)
+{
+	const u32 x = *(const u32*)a;
+	const u32 y = *(const u32*)b;
+	return (x > y) - (x < y);
+}
+
+// Tick count as milliseconds with 2 decimals.
+static int printMs(char *const buf, const u32 size, const char *const name, const u32 ticks)
+{
+	const u32 centiMs = (u32)((u64)ticks * 100 / g_ticksPerMs);
+	return ee_snprintf(buf, size, "%s: %lu.%02lu ms\n", name, centiMs / 100, centiMs % 100);
+}
+
+Result latencyWriteReport(const char *const path)
+{
+	if(g_testKey == 0) return RES_OK;
+
+	char *const buf = (char*)malloc(REPORT_BUF_SIZE);
+	if(buf == NULL) return RES_OUT_OF_MEM;
+
+	// Not measured if the game ran for less than CALIB_FRAMES.
+	if(g_ticksPerMs == 0) g_ticksPerMs = BASE_CORE_CLOCK / 64 / 1000;
+
+	const u32 num = g_numSamples;
+	u32 len = ee_snprintf(buf, REPORT_BUF_SIZE, "Samples: %lu\nTimeouts: %lu\n", num, g_timeouts);
+	if(num > 0)
+	{
+		u32 sorted[LATENCY_MAX_SAMPLES];
+		u64 sum = 0;
+		for(u32 i = 0; i < num; i++)
+		{
+			sorted[i] = g_samples[i];
+			sum += sorted[i];
+		}
+		qsort(sorted, num, sizeof(u32), cmpU32);
+
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "Min", sorted[0]);
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "Avg", (u32)(sum / num));
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "P50", sorted[num / 2]);
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "P90", sorted[num * 9 / 10]);
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "P99", sorted[num * 99 / 100]);
+		len += printMs(buf + len, REPORT_BUF_SIZE - len, "Max", sorted[num - 1]);
+
+		// Histogram with 1 frame (about 16.74 ms) buckets.
+		len += ee_snprintf(buf + len, REPORT_BUF_SIZE - len, "\nFrames: count\n");
+		const u32 frameTicks = g_ticksPerMs * 16742 / 1000;
+		for(u32 i = 0, bucket = 0; i < num; bucket++)
+		{
+			u32 count = 0;
+			while(i < num && sorted[i] / frameTicks == bucket) { count++; i++; }
+			if(count > 0) len += ee_snprintf(buf + len, REPORT_BUF_SIZE - len, "%lu: %lu\n", bucket, count);
+		}
+
+		// Raw samples in press order.
+		len += ee_snprintf(buf + len, REPORT_BUF_SIZE - len, "\nTicks (%lu per ms):\n", g_ticksPerMs);
+		for(u32 i = 0; i < num && len < REPORT_BUF_SIZE - 12; i++)
+			len += ee_snprintf(buf + len, REPORT_BUF_SIZE - len, "%lu\n", g_samples[i]);
+	}
+
+	return sdWriteAsync(path, buf, len, SD_WRITE_PRIO_LOW);
+}
@@ -24,12 +24,16 @@
 #include "arm11/console.h"
 #include "arm11/drivers/codec.h"
 #include "arm11/drivers/hid.h"
+#include "arm11/input_task.h"
 #include "arm11/power.h"
+#include "arm11/heap_profile.h"
 
 
 
 int main(void)
 {
+	heapProfInit();
+
 	Result res = fMount(FS_DRIVE_SDMC);
 	if(res == RES_OK) res = oafParseConfigEarly();
 	GFX_init(GFX_BGR8, GFX_RGB565);
@@ -41,8 +45,10 @@ int main(void)
 	{
 		while(1)
 		{
-			hidScanInput();
-			if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) break;
+			// The input task scans input while the GBA is running.
+			InputSnapshot input;
+			inputGetSnapshot(&input);
+			if(input.extra & (KEY_POWER_HELD | KEY_POWER)) break;
 
 			oafUpdate();
 		}
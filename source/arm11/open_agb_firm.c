@@ -22,6 +22,7 @@
   */
 
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
@@ -33,16 +34,32 @@
 #include "drivers/lgy.h"
 #include "arm11/drivers/lgyfb.h"
 #include "arm11/console.h"
+#include "arm11/db_index.h"
 #include "arm11/fmt.h"
 #include "drivers/gfx.h"
 #include "fs.h"
 #include "fsutil.h"
 #include "inih/ini.h"
+#include "arm11/arena.h"
+#include "arm11/cheats.h"
 #include "arm11/filebrowser.h"
+#include "arm11/keymap.h"
+#include "arm11/latency.h"
+#include "arm11/turbo.h"
+#include "arm11/ui_input.h"
+#include "arm11/heap_profile.h"
+#include "arm11/input_task.h"
 #include "arm11/drivers/lcd.h"
 #include "arm11/gpu_cmd_lists.h"
+#include "arm11/scaler_profiles.h"
 #include "arm11/drivers/mcu.h"
 #include "arm11/patch.h"
+#include "arm11/save_backup.h"
+#include "arm11/save_convert.h"
+#include "arm11/save_shard.h"
+#include "arm11/save_flush.h"
+#include "arm11/save_slots.h"
+#include "arm11/sd_writer.h"
 #include "kernel.h"
 #include "kevent.h"
 #include "arm11/drivers/codec.h"
@@ -51,6 +68,10 @@
 #define OAF_WORK_DIR    "sdmc:/3ds/open_agb_firm"
 #define OAF_SAVE_DIR    "saves"                   // Relative to work dir.
 #define INI_BUF_SIZE    (1024u)
+// One DirList (file or patch browser) + paths and temporary buffers.
+// The save backup needs 128 KiB + a few KiB after the browsers are gone.
+// Cheats need up to about 150 KiB (cheat file, database cheats and compiling).
+#define LAUNCH_ARENA_SIZE  (sizeof(DirList) + 1024u * 16)
 #define DEFAULT_CONFIG  "[general]\n"             \
                         "backlight=64\n"          \
                         "backlightSteps=5\n"      \
@@ -70,7 +91,12 @@
 						"brightnessStep=0.01\n\n" \
                         "[advanced]\n"            \
                         "saveOverride=false\n"    \
-                        "defaultSave=14"
+                        "defaultSave=14\n"        \
+                        "saveBackups=3\n"         \
+                        "saveFlushInterval=0\n"   \
+                        "slotPicker=false\n"     \
+                        "saveSharding=false\n"   \
+                        "latencyTest=NONE"
 
 typedef struct
 {
@@ -81,7 +107,7 @@ typedef struct
 	bool useGbaDb;
 
 	// [video]
-	u8 scaler;        // 0 = 1:1, 1 = bilinear (GPU) x1.5, 2 = matrix (hardware) x1.5.
+	u8 scaler;        // 0 = 1:1, 1 = bilinear (GPU) x1.5, 2 = matrix (hardware) x1.5, 3+ = scaler_profiles.h (hardware) x1.5.
 	float gbaGamma;
 	float lcdGamma;
 	float contrast;
@@ -101,6 +127,11 @@ typedef struct
 	// [advanced]
 	bool saveOverride;
 	u16 defaultSave;
+	u8 saveBackups;    // Number of rotating save backups. 0 = disabled.
+	bool slotPicker;   // Also opens when L is held at launch.
+	u16 saveFlushInterval; // Seconds between paused save writes while playing. 0 = only on sleep.
+	bool saveSharding; // Sub folders in the saves folder for large libraries.
+	u32 latencyTest;   // 3DS key mask of the latency test button. 0 = disabled.
 } OafConfig;
 
 typedef struct
@@ -141,7 +172,12 @@ static OafConfig g_oafConfig =
 
 	// [advanced]
 	false, // saveOverride
-	14     // defaultSave
+	14,    // defaultSave
+	3,     // saveBackups
+	false, // slotPicker
+	0,     // saveFlushInterval
+	false, // saveSharding
+	0      // latencyTest
 };
 
 typedef struct {
@@ -158,6 +194,10 @@ static DefaultDisplayConfig g_defaultDisplayConf = {
 };
 
 static KHandle g_frameReadyEvent = 0;
+// All allocations from oafParseConfigEarly() until the game starts.
+static Arena g_launchArena = {0};
+// Save path for slot 0. Used to update the slot index on exit.
+static char g_saveBasePath[512] = {0};
 
 static u32 fixRomPadding(u32 romFileSize)
 {
@@ -327,8 +367,25 @@ static Result searchGbaDb(u64 x, GameDbEntry *const db, s32 *const entryPos)
 {
 	debug_printf("Database search: '%016" PRIX64 "'\n", __builtin_bswap64(x));
 
-	Result res;
+	// Search the keys in memory and read only the found entry.
+	// Falls back to searching the file if the index can't be used.
+	Result res = dbIndexFind("gba_db.bin", "gba_db.idx", sizeof(GameDbEntry), offsetof(GameDbEntry, sha1), x, entryPos);
+	if(res == RES_NOT_FOUND) return res;
+
 	FHandle f;
+	if(res == RES_OK)
+	{
+		if((res = fOpen(&f, "gba_db.bin", FA_OPEN_EXISTING | FA_READ)) == RES_OK)
+		{
+			if((res = fLseek(f, sizeof(GameDbEntry) * *entryPos)) == RES_OK)
+				res = fRead(f, db, sizeof(GameDbEntry), NULL);
+			fClose(f);
+		}
+
+		return res;
+	}
+	debug_printf("gba_db.idx unusable: %s\n", oafResult2String(res));
+
 	if((res = fOpen(&f, "gba_db.bin", FA_OPEN_EXISTING | FA_READ)) == RES_OK)
 	{
 		s32 l = 0;
@@ -364,11 +421,10 @@ static Result searchGbaDb(u64 x, GameDbEntry *const db, s32 *const entryPos)
 	return res;
 }
 
-static u16 getSaveType(u32 romSize, const char *const savePath)
+static u16 getSaveType(u32 romSize, const char *const savePath, const u16 autoSaveType)
 {
 	FILINFO fi;
 	const bool saveOverride = g_oafConfig.saveOverride;
-	const u16 autoSaveType = detectSaveType(romSize);
 	const bool saveExists = fStat(savePath, &fi) == RES_OK;
 
 	u64 sha1[3];
@@ -429,14 +485,7 @@ static u16 getSaveType(u32 romSize, const char *const savePath)
 			oldCursor = cursor;
 
 			u32 kDown;
-			do
-			{
-				GFX_waitForVBlank0();
-
-				hidScanInput();
-				if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) goto end;
-				kDown = hidKeysDown();
-			} while(kDown == 0);
+			if(!uiWaitForKeys(&kDown)) goto end;
 
 			if((kDown & KEY_DUP) && cursor > 0)        cursor--;
 			else if((kDown & KEY_DDOWN) && cursor < 7) cursor++;
@@ -488,8 +537,42 @@ static void adjustGammaTableForGba(void)
 	}
 }
 
+// Overwrites the matrix LGYFB_init() programmed for scaler 2.
+static void applyScalerProfile(const ScalerProfile *const profile)
+{
+	debug_printf("Scaler profile: %s\n", profile->name);
+
+	LgyFb *const lgyFb = getLgyFbRegs(true);
+	lgyFb->v.len  = profile->vLen;
+	lgyFb->v.patt = profile->vPatt;
+	lgyFb->h.len  = profile->hLen;
+	lgyFb->h.patt = profile->hPatt;
+
+	for(u32 y = 0; y < 6; y++)
+	{
+		for(u32 x = 0; x < 8; x++)
+		{
+			lgyFb->v.matrix[y][x] = profile->vMatrix[y][x];
+			lgyFb->h.matrix[y][x] = profile->hMatrix[y][x];
+		}
+	}
+}
+
+// The dump is written straight from VRAM. Set until the write is done.
+static volatile bool g_frameDumpBusy = false;
+
+static void frameDumpDone(const void *data)
+{
+	(void)data;
+	g_frameDumpBusy = false;
+}
+
 static Result dumpFrameTex(void)
 {
+	// Skip the dump if the last one is still being written.
+	if(g_frameDumpBusy) return RES_WRITE_QUEUE_FULL;
+	g_frameDumpBusy = true;
+
 	// Stop LgyFb before dumping the frame to prevent glitches.
 	LGYFB_stop();
 
@@ -513,16 +596,16 @@ static Result dumpFrameTex(void)
 	GFX_waitForPPF();
 	memcpy((void*)0x18400000, bmpHeader, sizeof(bmpHeader));
 
+	// LgyFb only writes 0x18200000. It can run again while the copy
+	// at 0x18400000 is written in the background.
+	LGYFB_start();
+
 	RtcTimeDate td;
 	char fn[32];
 	MCU_getRtcTimeDate(&td);
 	ee_sprintf(fn, "texture_dump_%04X%02X%02X%02X%02X%02X.bmp", td.y + 0x2000, td.mon, td.d, td.h, td.min, td.s);
-	const Result res = fsQuickWrite(fn, (void*)0x18400000, 0x40 + 512 * 512 * 3);
-
-	// Restart LgyFb.
-	LGYFB_start();
 
-	return res;
+	return sdWriteAsyncBorrowed(fn, (void*)0x18400000, 0x40 + 512 * 512 * 3, SD_WRITE_PRIO_LOW, frameDumpDone);
 }
 
 static void gbaGfxHandler(void *args)
@@ -539,6 +622,14 @@ static void gbaGfxHandler(void *args)
 		if(waitForEvent(event) != KRES_OK) break;
 		clearEvent(event);
 
+		// Exactly once per GBA frame.
+		turboFrame();
+
+		// Frame synchronous so turbo toggles line up with GBA frames.
+		InputSnapshot input;
+		inputGetSnapshot(&input);
+		LGY_handleOverrides(keymapOverrides(turboApply(input.held), g_turboActive));
+
 		// Rotate the frame using the GPU.
 		// 240x160: TODO.
 		// 360x240: about 0.623620315 ms.
@@ -559,15 +650,26 @@ static void gbaGfxHandler(void *args)
 		}
 		GX_processCommandList(listSize, list);
 		GFX_waitForP3D();
+		u32 *const frame = (u32*)(GFX_getFramebuffer(SCREEN_TOP) + (16 * 240 * 3));
 		GX_displayTransfer((u32*)(0x18180000 + (16 * 240 * 3)), 368u<<16 | 240u,
-		                   GFX_getFramebuffer(SCREEN_TOP) + (16 * 240 * 3), 368u<<16 | 240u, 1u<<12 | 1u<<8);
+		                   frame, 368u<<16 | 240u, 1u<<12 | 1u<<8);
 		GFX_waitForPPF();
 		GFX_swapFramebufs();
+		latencyFrame(frame, 368 * 240 * 3);
 		// Scan input for KEY_SHELL and KEY_Y/KEY_SELECT
-		hidScanInput();
+		inputTaskScan();
+		inputGetSnapshot(&input);
 
 		curLgySleep = LGY_isSleeping();
-		curExtra = hidGetExtraKeys(0);
+		curExtra = input.extra;
+
+		// The save flush task owns the sleep state while it writes.
+		// Changes are picked up on the next frame after it finished.
+		if(saveFlushBusy())
+		{
+			curLgySleep = lastLgySleep;
+			curExtra = (curExtra & ~KEY_SHELL) | (lastExtra & KEY_SHELL);
+		}
 
 		// Check if shell was closed, or if GBA slept itself
 		if(((curExtra & KEY_SHELL) && !(lastExtra & KEY_SHELL))
@@ -579,6 +681,9 @@ static void gbaGfxHandler(void *args)
 
 			// Have ARM9 commandeer the ARM7 and force it into sleep
 			LGY_sleepGba();
+
+			// Good time to write the save. Nothing can change it now.
+			saveFlushSleep();
 		}
 		else if((!(curExtra & KEY_SHELL) && (lastExtra & KEY_SHELL) && !curLgySleep)
 		        || (!curLgySleep && lastLgySleep))
@@ -599,8 +704,10 @@ static void gbaGfxHandler(void *args)
 		lastExtra = curExtra;
 		lastLgySleep = curLgySleep;
 
+		if(!curLgySleep && !(curExtra & KEY_SHELL)) saveFlushFrame();
+
 		// Trigger only if both are held and at least one is detected as newly pressed down.
-		if(hidKeysHeld() == (KEY_Y | KEY_SELECT) && hidKeysDown() != 0)
+		if(input.held == (KEY_Y | KEY_SELECT) && input.down != 0)
 			dumpFrameTex();
 	}
 
@@ -658,12 +765,30 @@ static int cfgIniCallback(void* user, const char* section, const char* name, con
 		if(strcmp(name, "saveType") == 0)
 			config->saveType = (u8)strtoul(value, NULL, 10);
 	}
+	else if(strcmp(section, "input") == 0)
+	{
+		if(!turboParse(name, value) && !keymapParse(name, value))
+			debug_printf("Invalid key mapping: %s=%s\n", name, value);
+	}
 	else if(strcmp(section, "advanced") == 0)
 	{
 		if(strcmp(name, "saveOverride") == 0)
 			config->saveOverride = (strcmp(value, "false") == 0 ? false : true);
 		if(strcmp(name, "defaultSave") == 0)
 			config->defaultSave = (u16)strtoul(value, NULL, 10);
+		if(strcmp(name, "saveBackups") == 0)
+			config->saveBackups = (u8)strtoul(value, NULL, 10);
+		if(strcmp(name, "slotPicker") == 0)
+			config->slotPicker = (strcmp(value, "false") == 0 ? false : true);
+		if(strcmp(name, "saveFlushInterval") == 0)
+			config->saveFlushInterval = (u16)strtoul(value, NULL, 10);
+		if(strcmp(name, "saveSharding") == 0)
+			config->saveSharding = (strcmp(value, "false") == 0 ? false : true);
+		if(strcmp(name, "latencyTest") == 0)
+		{
+			const s8 bit = keymapKeyBit(value);
+			config->latencyTest = (bit < 0 ? 0 : 1u<<bit);
+		}
 	}
 	else return 0; // Error.
 
@@ -672,7 +797,8 @@ static int cfgIniCallback(void* user, const char* section, const char* name, con
 
 static Result parseOafConfig(const char *const path, const bool writeDefaultCfg)
 {
-	char *iniBuf = (char*)calloc(INI_BUF_SIZE, 1);
+	const ArenaMark mark = arenaMark(&g_launchArena);
+	char *iniBuf = (char*)arenaCalloc(&g_launchArena, INI_BUF_SIZE);
 	if(iniBuf == NULL) return RES_OUT_OF_MEM;
 
 	Result res = fsQuickRead(path, iniBuf, INI_BUF_SIZE - 1);
@@ -680,10 +806,10 @@ static Result parseOafConfig(const char *const path, const bool writeDefaultCfg)
 	else if(writeDefaultCfg)
 	{
 		const char *const defaultConfig = DEFAULT_CONFIG;
-		res = fsQuickWrite(path, defaultConfig, strlen(defaultConfig));
+		res = sdWriteAsyncCopy(path, defaultConfig, strlen(defaultConfig), SD_WRITE_PRIO_HIGH);
 	}
 
-	free(iniBuf);
+	arenaReset(&g_launchArena, mark);
 
 	g_defaultDisplayConf.brightness = g_oafConfig.brightness;
 	g_defaultDisplayConf.contrast   = g_oafConfig.contrast;
@@ -718,7 +844,8 @@ void changeBacklight(s16 amount)
 static Result showFileBrowser(char romAndSavePath[512])
 {
 	Result res;
-	char *lastDir = (char*)calloc(512, 1);
+	const ArenaMark mark = arenaMark(&g_launchArena);
+	char *lastDir = (char*)arenaCalloc(&g_launchArena, 512);
 	if(lastDir != NULL)
 	{
 		do
@@ -732,11 +859,11 @@ static Result showFileBrowser(char romAndSavePath[512])
 
 			// Show file browser.
 			*romAndSavePath = '\0';
-			if((res = browseFiles(lastDir, romAndSavePath)) == RES_FR_NO_PATH)
+			if((res = browseFiles(lastDir, romAndSavePath, &g_launchArena)) == RES_FR_NO_PATH)
 			{
 				// Second chance in case the last dir has been deleted.
 				strcpy(lastDir, "sdmc:/");
-				if((res = browseFiles(lastDir, romAndSavePath)) != RES_OK) break;
+				if((res = browseFiles(lastDir, romAndSavePath, &g_launchArena)) != RES_OK) break;
 			}
 			else if(res != RES_OK) break;
 
@@ -748,12 +875,12 @@ static Result showFileBrowser(char romAndSavePath[512])
 				{
 					strncpy(lastDir, romAndSavePath, cmpLen);
 					lastDir[cmpLen] = '\0';
-					res = fsQuickWrite("lastdir.txt", lastDir, cmpLen + 1);
+					res = sdWriteAsyncCopy("lastdir.txt", lastDir, cmpLen + 1, SD_WRITE_PRIO_NORMAL);
 				}
 			}
 		} while(0);
 
-		free(lastDir);
+		arenaReset(&g_launchArena, mark);
 	}
 	else res = RES_OUT_OF_MEM;
 
@@ -794,24 +921,33 @@ Result oafParseConfigEarly(void)
 	Result res;
 	do
 	{
+		if((res = arenaInit(&g_launchArena, LAUNCH_ARENA_SIZE)) != RES_OK) break;
+
 		// Create the work dir and switch to it.
 		if((res = fsMakePath(OAF_WORK_DIR)) != RES_OK && res != RES_FR_EXIST) break;
 		if((res = fChdir(OAF_WORK_DIR)) != RES_OK) break;
+		sdWriterInit();
 
 		// Create the saves folder.
 		if((res = fMkdir(OAF_SAVE_DIR)) != RES_OK && res != RES_FR_EXIST) break;
 
 		// Parse the config.
-		res = parseOafConfig("config.ini", true);
+		if((res = parseOafConfig("config.ini", true)) != RES_OK) break;
+
+		// Not fatal. The flat saves folder is used if the migration fails.
+		const Result shardRes = saveShardInit(g_oafConfig.saveSharding, &g_launchArena);
+		if(shardRes != RES_OK) debug_printf("Save sharding failed: %s\n", oafResult2String(shardRes));
 	} while(0);
 
+	if(res != RES_OK) arenaRelease(&g_launchArena);
+
 	return res;
 }
 
 Result oafInitAndRun(void)
 {
 	Result res;
-	char *const filePath = (char*)calloc(512, 1);
+	char *const filePath = (char*)arenaCalloc(&g_launchArena, 512);
 	if(filePath != NULL)
 	{
 		do
@@ -827,9 +963,8 @@ Result oafInitAndRun(void)
 
 			//make copy of rom path
 			//MOVE TO PATCH-SKIP CHECK?
-			char *const romFilePath = (char*)calloc(strlen(filePath)+1, 1);
+			const char *const romFilePath = arenaStrdup(&g_launchArena, filePath);
 			if(romFilePath == NULL) { res = RES_OUT_OF_MEM; break; }
-			strcpy(romFilePath, filePath);
 
 			// Load the ROM file.
 			u32 romSize;
@@ -837,25 +972,77 @@ Result oafInitAndRun(void)
 
 			// Load the per-game config.
 			rom2GameCfgPath(filePath);
+			saveShardPath(filePath);
 			if((res = parseOafConfig(filePath, false)) != RES_OK && res != RES_FR_NO_FILE) break;
+			keymapCompile();
+			turboCompile();
+
+			// Slot picker. Slots > 9 mean no save so don't offer it.
+			// Before the save type detection so it looks at the picked save.
+			hidScanInput();
+			if((g_oafConfig.slotPicker || (hidKeysHeld() & KEY_L)) && g_oafConfig.saveSlot < NUM_SAVE_SLOTS)
+			{
+				SaveSlotIndex slotIdx;
+				if(slotIndexLoad(filePath, &slotIdx) == RES_OK)
+					g_oafConfig.saveSlot = slotPicker(&slotIdx, g_oafConfig.saveSlot);
+			}
+			safeStrcpy(g_saveBasePath, filePath, sizeof(g_saveBasePath));
 
 			// Adjust the path for the save file and get save type.
-			u16 saveType;
-			if(g_oafConfig.saveType != 0xFF)
-				saveType = g_oafConfig.saveType;
-			else if(g_oafConfig.useGbaDb || g_oafConfig.saveOverride)
-				saveType = getSaveType(romSize, filePath);
-			else
-				saveType = detectSaveType(romSize);
-
-			//if X is held during launch, skip patching
+			u16 saveType = g_oafConfig.saveType;
+			if(saveType == 0xFF)
+			{
+				// An existing save usually pins the save type which skips the ROM scan.
+				// Only flash needs the database for the chip and RTC. The override menu always does the full detection.
+				u16 autoSaveType = 0xFF;
+				if(!g_oafConfig.saveOverride && checkSaveOverride(*(u32*)(ROM_LOC + 0xAC)) == 0xFF)
+				{
+					char *const savePath = (char*)arenaAlloc(&g_launchArena, 512);
+					if(savePath == NULL) { res = RES_OUT_OF_MEM; break; }
+					strcpy(savePath, filePath);
+					gameCfg2SavePath(savePath, g_oafConfig.saveSlot);
+					autoSaveType = saveTypeFromSave(savePath, romSize, &g_launchArena);
+					debug_printf("saveType from existing save: %u\n", autoSaveType);
+				}
+
+				bool needsDb = g_oafConfig.saveOverride || g_oafConfig.useGbaDb;
+				if(autoSaveType == 0xFF) autoSaveType = detectSaveType(romSize);
+				else needsDb = autoSaveType >= SAVE_TYPE_FLASH_512k_AML_RTC && autoSaveType < SAVE_TYPE_SRAM_256k && g_oafConfig.useGbaDb;
+
+				if(needsDb)
+					saveType = getSaveType(romSize, filePath, autoSaveType);
+				else
+					saveType = autoSaveType;
+			}
+
+			//if X is held during launch, skip patching and cheats
 			hidScanInput();
 			if(hidKeysHeld() != KEY_X)
-				patchRom(romFilePath, &romSize, filePath);
-			free(romFilePath);
+			{
+				// Patches and cheats for a specific revision match the CRC32
+				// of the unpatched ROM. It's calculated at most once.
+				RomInfo romInfo;
+				Result cheatRes = romInfoInit(romFilePath, &romInfo);
+				const bool haveRomInfo = cheatRes == RES_OK;
+				if(haveRomInfo) cheatRes = cheatsPrepare(romFilePath, &romInfo, &g_launchArena);
+
+				patchRom(romFilePath, &romSize, filePath, (haveRomInfo ? &romInfo : NULL), &g_launchArena);
+
+				// Cheats are applied on top of the patched ROM.
+				if(cheatRes == RES_OK) cheatRes = cheatsApply(romFilePath, romSize, &romInfo, &g_launchArena);
+				if(cheatRes != RES_OK && cheatRes != RES_FR_NO_FILE) debug_printf("Cheats failed: %s\n", oafResult2String(cheatRes));
+			}
 
 			gameCfg2SavePath(filePath, g_oafConfig.saveSlot);
 
+			// Back up the save before it's loaded. A failed backup is not fatal.
+			const Result backupRes = backupSave(filePath, g_oafConfig.saveBackups, &g_launchArena);
+			if(backupRes != RES_OK) debug_printf("Save backup failed: %s\n", oafResult2String(backupRes));
+
+			// Fix emulator saves with the wrong size. Runs after the backup so the original is kept.
+			const Result convRes = convertSave(filePath, saveType, &g_launchArena);
+			if(convRes != RES_OK) debug_printf("Save conversion failed: %s\n", oafResult2String(convRes));
+
 			// Prepare ARM9 for GBA mode + save loading.
 			if((res = LGY_prepareGbaMode(g_oafConfig.directBoot, saveType, filePath)) == RES_OK)
 			{
@@ -867,11 +1054,19 @@ Result oafInitAndRun(void)
 #endif
 
 				// Initialize the legacy frame buffer and frame handler.
+				// Custom profiles use the same setup as the hardware matrix scaler.
+				u8 scaler = g_oafConfig.scaler;
+				if(scaler > 2 + NUM_SCALER_PROFILES) scaler = 2;
+				const u8 hwScaler = (scaler > 2 ? 2 : scaler);
 				const KHandle frameReadyEvent = createEvent(false);
-				LGYFB_init(frameReadyEvent, g_oafConfig.scaler); // Setup Legacy Framebuffer.
-				patchGbaGpuCmdList(g_oafConfig.scaler);
+				LGYFB_init(frameReadyEvent, hwScaler); // Setup Legacy Framebuffer.
+				if(scaler > 2) applyScalerProfile(&g_scalerProfiles[scaler - 3]);
+				patchGbaGpuCmdList(hwScaler);
 				createTask(0x800, 3, gbaGfxHandler, (void*)frameReadyEvent);
 				g_frameReadyEvent = frameReadyEvent;
+				latencyInit(g_oafConfig.latencyTest);
+				inputTaskInit();
+				saveFlushInit(g_oafConfig.saveFlushInterval);
 
 				// Adjust gamma table and sync LgyFb start with LCD VBlank.
 				adjustGammaTableForGba();
@@ -882,7 +1077,11 @@ Result oafInitAndRun(void)
 	}
 	else res = RES_OUT_OF_MEM;
 
-	free(filePath);
+	// Launch errors power off right after this.
+	sdWriterFlush();
+
+	debug_printf("Launch arena peak: %lu of %lu bytes\n", g_launchArena.peak, g_launchArena.size);
+	arenaRelease(&g_launchArena);
 
 	return res;
 }
@@ -955,7 +1154,7 @@ static void slowAdjustGammaTableForGba(bool firstRun)
 }
 */
 
-static void adjustDisplaySettings() {
+static void adjustDisplaySettings(const InputSnapshot *const input) {
 	static bool firstRun = true;
 	static bool backlightOn = true;
 
@@ -976,8 +1175,11 @@ static void adjustDisplaySettings() {
 		firstRun = false;
 	}
 
-	const u32 kHeld = hidKeysHeld();
-	const u32 kDown = hidKeysDown();
+	// Handle every snapshot only once.
+	static u32 lastFrame = 0;
+	const u32 kHeld = input->held;
+	const u32 kDown = (input->frame != lastFrame ? input->down : 0);
+	lastFrame = input->frame;
 	if(g_oafConfig.advanceDisplayControl && kDown && kHeld) {
 		if(kDown & KEY_Y) {
 			//change mode
@@ -1098,20 +1300,33 @@ static void adjustDisplaySettings() {
 
 void oafUpdate(void)
 {
-	u16 input = 0xffff;
+	InputSnapshot input;
+	inputGetSnapshot(&input);
 
-	LGY_handleOverrides(input);
-	adjustDisplaySettings();
+	adjustDisplaySettings(&input);
 	waitForEvent(g_frameReadyEvent);
 }
 
 void oafFinish(void)
 {
+	saveFlushDeinit();
 	LGYFB_deinit();
 	if(g_frameReadyEvent != 0)
 	{
 		deleteEvent(g_frameReadyEvent); // gbaGfxHandler() will automatically terminate.
 		g_frameReadyEvent = 0;
 	}
+	inputTaskDeinit();
 	LGY_deinit();
+
+	// The save has been written. Keep the slot picker info up to date.
+	if(*g_saveBasePath != '\0') slotIndexUpdate(g_saveBasePath, g_oafConfig.saveSlot);
+
+	// Debug builds only. Relative to the work dir.
+	heapProfWriteReport("heap_profile.bin");
+
+	const Result latRes = latencyWriteReport("latency.txt");
+	if(latRes != RES_OK) debug_printf("Latency report failed: %s\n", oafResult2String(latRes));
+
+	sdWriterDeinit();
 }
@@ -27,12 +27,12 @@
 #include "fs.h"
 #include "fsutil.h"
 #include "arm11/patch.h"
-#include "arm11/power.h"
 #include "drivers/sha.h"
 #include "arm11/buffer.h"
+#include "arm11/arena.h"
 #include "arm11/filebrowser.h"
-#include "drivers/gfx.h"
-#include "arm11/drivers/codec.h"
+#include "arm11/ui_input.h"
+#include "arm11/patch_meta.h"
 
 #define MAX_PATH_SIZE 512
 #define MAX_BUFFER_SIZE 512
@@ -267,11 +267,7 @@ static Result applyPatch(FHandle patchFile, u32 *romSize) {
 #ifndef NDEBUG
 		ee_printf("Error Code: %s", result2String(res));
 #endif
-		while(1){
-			hidScanInput();
-			if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
-			if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
-		}
+		uiWaitForCombo(KEY_Y | KEY_DUP);
 
 		return res;
 	}
@@ -288,11 +284,7 @@ static Result applyPatch(FHandle patchFile, u32 *romSize) {
 #ifndef NDEBUG
 		ee_printf("Error Code: %s", result2String(res));
 #endif
-		while(1){
-			hidScanInput();
-			if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
-			if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
-		}
+		uiWaitForCombo(KEY_Y | KEY_DUP);
 
 		return res;
 	}
@@ -306,12 +298,14 @@ static Result applyPatch(FHandle patchFile, u32 *romSize) {
  * @param[in]     path     Path to scan
  * @param[in,out] dList    DirList to store detected files
  * @param [in]    filter   File extension to search for
+ * @param[in,out] arena    Arena for temporary allocations
  * 
  * @return Result of operation
  */
-Result scanAppendFiles(const char *const path, DirList *const dList, const char *const filter)
+Result scanAppendFiles(const char *const path, DirList *const dList, const char *const filter, Arena *const arena)
 {
-	FILINFO *const fis = (FILINFO*)malloc(sizeof(FILINFO) * DIR_READ_BLOCKS);
+	const ArenaMark mark = arenaMark(arena);
+	FILINFO *const fis = (FILINFO*)arenaAlloc(arena, sizeof(FILINFO) * DIR_READ_BLOCKS);
 	if(fis == NULL) return RES_OUT_OF_MEM;
 
 	Result res;
@@ -359,7 +353,7 @@ scanEnd:
 		fCloseDir(dh);
 	}
 
-	free(fis);
+	arenaReset(arena, mark);
 
 	qsort(dList->ptrs, dList->num, sizeof(char*), dlistCompare);
 
@@ -375,14 +369,17 @@ scanEnd:
  * @param[in]     gamePath   Path of the loaded rom
  * @param[in,out] romSize    Size of currently loaded rom
  * @param[in,out] savePath   Path fo the game save file
+ * @param[in,out] rom        The unpatched ROM file or NULL. Its CRC32 is calculated if a patch needs it
+ * @param[in,out] arena      Arena for temporary allocations. Reset to its previous state on return
  * 
  * @return Result of operation
  */
-Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
+Result patchRom(const char *const gamePath, u32 *romSize, char* savePath, RomInfo *const rom, Arena *const arena) {
 	Result res = RES_OK;
 	FHandle patchFile;
 
-	char *workingPath = (char*)calloc(MAX_PATH_SIZE, 1);
+	const ArenaMark mark = arenaMark(arena);
+	char *workingPath = (char*)arenaCalloc(arena, MAX_PATH_SIZE);
 
 	// Check for single patch
 	if(workingPath != NULL) {
@@ -415,14 +412,17 @@ Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
 		}
 
 		//create new workingPath
-		char *gameName = malloc( strlen(gamePath)-breakPos+1 );
-		strncpy(gameName, gamePath+breakPos, strlen(gamePath)-breakPos+1);
+		const char *const gameName = arenaStrdup(arena, gamePath+breakPos);
+		if(gameName == NULL) {
+			res = RES_OUT_OF_MEM;
+			goto cleanup;
+		}
 		strncpy(workingPath, PATCH_PATH_BASE, MAX_PATH_SIZE-1);
 		strncat(workingPath, gameName, MAX_PATH_SIZE-1);
 		
 		*(endStringOffset(workingPath, 4)) = '\0';
 
-		DirList *const patchList = (DirList*)calloc(1, sizeof(DirList)); //initialize memory to make it easier to find starting free index when merging
+		DirList *const patchList = (DirList*)arenaCalloc(arena, sizeof(DirList)); //initialize memory to make it easier to find starting free index when merging
 		if(patchList == NULL) {
 			ee_printf("Error making patchList");
 			res = RES_OUT_OF_MEM;
@@ -434,57 +434,49 @@ Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
 		DHandle tempDir;
 		if((res = fOpenDir(&tempDir, workingPath)) != RES_OK) {
 			ee_printf("Bad directory: %s\n", workingPath);
-			free(patchList);
 			if(res == RES_FR_NO_PATH) res = RES_OK;
 			goto cleanup; 
 		}
 		fCloseDir(tempDir);
 
 		//get all patch files
-		if((res = scanAppendFiles(workingPath, patchList, ".ips")) != RES_OK) {
+		if((res = scanAppendFiles(workingPath, patchList, ".ips", arena)) != RES_OK) {
 			ee_printf("Error fetching IPS list");
-			free(patchList);
 			goto cleanup;
 		}
 		
-		if((res = scanAppendFiles(workingPath, patchList, ".ups")) != RES_OK) {
+		if((res = scanAppendFiles(workingPath, patchList, ".ups", arena)) != RES_OK) {
 			ee_printf("Error fetching UPS list");
-			free(patchList);
 			goto cleanup;
 		}
 
 		//Open patch browser
-		if((patchList->num) == 0) {
-			free(patchList);
+		if((patchList->num) == 0) goto cleanup;
+
+		//summaries shown below the list. Without them the whole screen is used for the list
+		//the unpatched ROM file is used to hide patches made for other ROMs (revisions)
+		PatchMeta *metas = (PatchMeta*)arenaAlloc(arena, sizeof(PatchMeta) * patchList->num);
+		if(metas != NULL && patchMetaLoad(workingPath, patchList, metas, rom, arena) != RES_OK) metas = NULL;
+		if(metas != NULL && rom != NULL && patchMetaFilter(patchList, metas, rom) > 0 && patchList->num == 0) {
+			ee_puts("No patch in the patch folder is made for this ROM.");
 			goto cleanup;
 		}
+		const u32 listRows = (metas != NULL ? SCREEN_ROWS - PATCH_META_ROWS : SCREEN_ROWS);
 
 		//display patches in the patch folder
 		//Pretty much all of this code is a copy of browseFiles(), may be able to remove it with slight changes to browseFiles()
 		s32 cursorPos = 0;
 		s32 oldCursorPos = 0;
 		u32 windowPos = 0;
-		showDirList(patchList, 0);
+		showDirListRows(patchList, 0, listRows);
 
 		u32 kDown = 0;
 		while (1) {
 			ee_printf("\x1b[%lu;H ", oldCursorPos - windowPos);      // Clear old cursor.
 			ee_printf("\x1b[%lu;H\x1b[37m>", cursorPos - windowPos); // Draw cursor.
+			if(metas != NULL) patchMetaShow(&metas[cursorPos]);
 
-			do
-			{
-				GFX_waitForVBlank0();
-
-				hidScanInput();
-				if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) {
-					CODEC_deinit();
-					GFX_deinit();
-					fUnmount(FS_DRIVE_SDMC);
-
-					power_off();
-				}
-				kDown = hidKeysDown();
-			} while(kDown == 0);
+			if(!uiWaitForKeys(&kDown)) uiPowerOff();
 
 			oldCursorPos = cursorPos;
 
@@ -519,29 +511,11 @@ Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
 						res = fsMakePath(savePath);
 						if(res != RES_OK) {
 							ee_printf("An error has occurred while creating for folder %s\n%s", savePath, result2String(res));
-							while (1) {
-								hidScanInput();
-								if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) {
-									CODEC_deinit();
-									GFX_deinit();
-									fUnmount(FS_DRIVE_SDMC);
-
-									power_off();
-								}
-							}
+							uiWaitForPowerOff();
 						}
 					} else {
 						ee_printf("An error has occurred while checking for folder %s\n%s", savePath, result2String(res));
-						while (1) {
-							hidScanInput();
-							if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) {
-								CODEC_deinit();
-								GFX_deinit();
-								fUnmount(FS_DRIVE_SDMC);
-
-								power_off();
-							}
-						}
+						uiWaitForPowerOff();
 					}
 				}
 				fCloseDir(tempDir);
@@ -557,12 +531,12 @@ Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
 
 			if(kDown & KEY_DRIGHT)
 			{
-				cursorPos += SCREEN_ROWS;
+				cursorPos += listRows;
 				if((u32)cursorPos > (patchList->num)) cursorPos = (patchList->num) - 1;
 			}
 			if(kDown & KEY_DLEFT)
 			{
-				cursorPos -= SCREEN_ROWS;
+				cursorPos -= listRows;
 				if(cursorPos < -1) cursorPos = 0;
 			}
 
@@ -575,22 +549,20 @@ Result patchRom(const char *const gamePath, u32 *romSize, char* savePath) {
 			if((u32)cursorPos < windowPos)
 			{
 				windowPos = cursorPos;
-				showDirList(patchList, windowPos);
+				showDirListRows(patchList, windowPos, listRows);
 			}
-			if((u32)cursorPos >= windowPos + SCREEN_ROWS)
+			if((u32)cursorPos >= windowPos + listRows)
 			{
-				windowPos = cursorPos - (SCREEN_ROWS - 1);
-				showDirList(patchList, windowPos);
+				windowPos = cursorPos - (listRows - 1);
+				showDirListRows(patchList, windowPos, listRows);
 			}
 
 		}
-
-		free(patchList);
 	}
 	else res = RES_OUT_OF_MEM;
 
 cleanup:
-	free(workingPath);
+	arenaReset(arena, mark);
 
 	if(res == RES_INVALID_PATCH) {
 		ee_puts("No valid patch found! Skipping...\n");
@@ -0,0 +1,329 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "arm11/fmt.h"
+#include "arm11/arena.h"
+#include "arm11/filebrowser.h"
+#include "arm11/rom_info.h"
+#include "arm11/patch_meta.h"
+
+
+#define MAX_PATH_SIZE  (512u)
+
+
+static u32 hashName(const char *str)
+{
+	// FNV-1a.
+	u32 hash = 2166136261u;
+	while(*str != '\0')
+	{
+		hash ^= (u8)*str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static u32 readBe24(const u8 *const p)
+{
+	return (u32)p[0]<<16 | (u32)p[1]<<8 | p[2];
+}
+
+static u32 readLe32(const u8 *const p)
+{
+	return (u32)p[3]<<24 | (u32)p[2]<<16 | (u32)p[1]<<8 | p[0];
+}
+
+// Walks the record headers and skips the data.
+static void parseIps(const FHandle f, const u32 fileSize, PatchMeta *const meta)
+{
+	u8 hdr[5];
+	if(fRead(f, hdr, 5, NULL) != RES_OK || memcmp(hdr, "PATCH", 5) != 0) return;
+
+	u32 pos = 5;
+	u32 records = 0;
+	u32 dstSize = 0;
+	while(1)
+	{
+		if(pos + 3 > fileSize || fRead(f, hdr, 3, NULL) != RES_OK) return;
+		pos += 3;
+		if(memcmp(hdr, "EOF", 3) == 0) break;
+
+		if(pos + 2 > fileSize || fRead(f, &hdr[3], 2, NULL) != RES_OK) return;
+		pos += 2;
+		const u32 offset = readBe24(hdr);
+		u32 length = (u32)hdr[3]<<8 | hdr[4];
+
+		if(length == 0) // RLE record.
+		{
+			if(pos + 3 > fileSize || fRead(f, hdr, 3, NULL) != RES_OK) return;
+			pos += 3;
+			length = (u32)hdr[0]<<8 | hdr[1];
+		}
+		else
+		{
+			pos += length;
+			if(pos > fileSize || fLseek(f, pos) != RES_OK) return;
+		}
+
+		records++;
+		if(offset + length > dstSize) dstSize = offset + length;
+	}
+
+	meta->flags = PATCH_META_DST_MIN;
+	// Optional truncation extension.
+	if(pos + 3 <= fileSize && fRead(f, hdr, 3, NULL) == RES_OK)
+	{
+		dstSize = readBe24(hdr);
+		meta->flags = 0;
+	}
+
+	meta->format = PATCH_FMT_IPS;
+	meta->records = records;
+	meta->dstSize = dstSize;
+}
+
+// Same decoding as read_vuint() in patch.c.
+static bool readVuint(const u8 *const buf, const u32 size, u32 *const pos, u32 *const out)
+{
+	u32 result = 0, shift = 0;
+	while(*pos < size && shift < 32)
+	{
+		const u8 octet = buf[(*pos)++];
+		if(octet & 0x80)
+		{
+			*out = result + ((octet & 0x7Fu)<<shift);
+			return true;
+		}
+		result += (octet | 0x80u)<<shift;
+		shift += 7;
+	}
+
+	return false;
+}
+
+// Sizes from the header and checksums from the footer. The hunks are not read.
+static void parseUps(const FHandle f, const u32 fileSize, PatchMeta *const meta)
+{
+	if(fileSize < 4 + 2 + 12) return;
+
+	u8 buf[24];
+	const u32 size = (fileSize - 12 < sizeof(buf) ? fileSize - 12 : sizeof(buf));
+	if(fRead(f, buf, size, NULL) != RES_OK || memcmp(buf, "UPS1", 4) != 0) return;
+
+	u32 pos = 4;
+	u32 srcSize, dstSize;
+	if(!readVuint(buf, size, &pos, &srcSize) || !readVuint(buf, size, &pos, &dstSize)) return;
+
+	// Source, target and patch CRC32.
+	if(fLseek(f, fileSize - 12) != RES_OK || fRead(f, buf, 12, NULL) != RES_OK) return;
+
+	meta->format = PATCH_FMT_UPS;
+	meta->srcSize = srcSize;
+	meta->dstSize = dstSize;
+	meta->srcCrc = readLe32(&buf[0]);
+	meta->dstCrc = readLe32(&buf[4]);
+}
+
+static void parsePatch(const char *const path, PatchMeta *const meta)
+{
+	FHandle f;
+	if(fOpen(&f, path, FA_OPEN_EXISTING | FA_READ) != RES_OK) return;
+
+	const u32 nameLen = strlen(path);
+	if(nameLen > 4 && strcmp(path + nameLen - 4, ".ups") == 0) parseUps(f, meta->fileSize, meta);
+	else                                                       parseIps(f, meta->fileSize, meta);
+
+	fClose(f);
+}
+
+// Returns the cached entries or NULL. hdr->num is 0 if there is no usable cache.
+static const PatchMeta* loadCache(const char *const path, PatchMetaCacheHeader *const hdr, Arena *const arena)
+{
+	memset(hdr, 0, sizeof(PatchMetaCacheHeader));
+
+	FHandle f;
+	if(fOpen(&f, path, FA_OPEN_EXISTING | FA_READ) != RES_OK) return NULL;
+
+	PatchMeta *metas = NULL;
+	if(fRead(f, hdr, sizeof(PatchMetaCacheHeader), NULL) == RES_OK && hdr->magic == PATCH_META_MAGIC &&
+	   hdr->version == PATCH_META_VERSION && hdr->num <= MAX_DIR_ENTRIES &&
+	   fSize(f) == sizeof(PatchMetaCacheHeader) + hdr->num * sizeof(PatchMeta))
+	{
+		metas = (PatchMeta*)arenaAlloc(arena, hdr->num * sizeof(PatchMeta));
+		if(metas == NULL || fRead(f, metas, hdr->num * sizeof(PatchMeta), NULL) != RES_OK) metas = NULL;
+	}
+
+	fClose(f);
+
+	if(metas == NULL) memset(hdr, 0, sizeof(PatchMetaCacheHeader));
+
+	return metas;
+}
+
+Result patchMetaLoad(const char *const dir, const DirList *const list, PatchMeta *const metas,
+                     RomInfo *const rom, Arena *const arena)
+{
+	memset(metas, 0, sizeof(PatchMeta) * list->num);
+
+	const ArenaMark mark = arenaMark(arena);
+	char *const path = (char*)arenaAlloc(arena, MAX_PATH_SIZE);
+	if(path == NULL) return RES_OUT_OF_MEM;
+
+	ee_snprintf(path, MAX_PATH_SIZE, "%s/" PATCH_META_CACHE_NAME, dir);
+	PatchMetaCacheHeader cachedHdr;
+	const PatchMeta *const cached = loadCache(path, &cachedHdr, arena);
+	const u32 cachedNum = cachedHdr.num;
+
+	// Rewrite the cache if anything was parsed or patches were removed.
+	bool dirty = cachedNum != list->num;
+	for(u32 i = 0; i < list->num; i++)
+	{
+		const char *const name = &list->ptrs[i][1];
+		ee_snprintf(path, MAX_PATH_SIZE, "%s/%s", dir, name);
+
+		FILINFO fi;
+		if(fStat(path, &fi) != RES_OK) continue;
+
+		PatchMeta *const meta = &metas[i];
+		meta->nameHash = hashName(name);
+		meta->fileSize = fi.fsize;
+		meta->fdate = fi.fdate;
+		meta->ftime = fi.ftime;
+
+		u32 j = 0;
+		for(; j < cachedNum; j++)
+		{
+			const PatchMeta *const c = &cached[j];
+			if(c->nameHash == meta->nameHash && c->fileSize == meta->fileSize &&
+			   c->fdate == meta->fdate && c->ftime == meta->ftime) break;
+		}
+
+		if(j < cachedNum) *meta = cached[j];
+		else
+		{
+			parsePatch(path, meta);
+			dirty = true;
+		}
+	}
+
+	// Only patches with a source checksum need the ROM CRC32.
+	if(rom != NULL)
+	{
+		for(u32 i = 0; i < list->num; i++)
+		{
+			if(metas[i].format == PATCH_FMT_UPS)
+			{
+				romInfoAdopt(rom, &cachedHdr.rom);
+				romInfoCrc(rom);
+				dirty |= memcmp(&cachedHdr.rom, rom, sizeof(RomInfo)) != 0;
+				break;
+			}
+		}
+	}
+
+	if(dirty)
+	{
+		const u32 size = sizeof(PatchMetaCacheHeader) + sizeof(PatchMeta) * list->num;
+		PatchMetaCacheHeader *const hdr = (PatchMetaCacheHeader*)arenaAlloc(arena, size);
+		if(hdr != NULL)
+		{
+			hdr->magic = PATCH_META_MAGIC;
+			hdr->version = PATCH_META_VERSION;
+			hdr->reserved = 0;
+			hdr->num = list->num;
+			if(rom != NULL && rom->crcValid) hdr->rom = *rom;
+			else                             memset(&hdr->rom, 0, sizeof(RomInfo));
+			memcpy(hdr + 1, metas, sizeof(PatchMeta) * list->num);
+
+			// Not fatal. The patches are parsed again next time.
+			ee_snprintf(path, MAX_PATH_SIZE, "%s/" PATCH_META_CACHE_NAME, dir);
+			if(fsQuickWrite(path, hdr, size) != RES_OK) debug_printf("Failed to write %s\n", path);
+		}
+	}
+
+	arenaReset(arena, mark);
+
+	return RES_OK;
+}
+
+u32 patchMetaFilter(DirList *const list, PatchMeta *const metas, const RomInfo *const rom)
+{
+	if(!rom->crcValid) return 0;
+
+	u32 kept = 0;
+	for(u32 i = 0; i < list->num; i++)
+	{
+		const PatchMeta *const meta = &metas[i];
+		if(meta->format == PATCH_FMT_UPS && (meta->srcSize != rom->size || meta->srcCrc != rom->crc))
+		{
+			debug_printf("Skipping %s (made for another ROM).\n", &list->ptrs[i][1]);
+			continue;
+		}
+
+		list->ptrs[kept] = list->ptrs[i];
+		metas[kept] = *meta;
+		kept++;
+	}
+
+	const u32 removed = list->num - kept;
+	list->num = kept;
+
+	return removed;
+}
+
+void patchMetaShow(const PatchMeta *const meta)
+{
+	char lines[PATCH_META_ROWS][SCREEN_COLS + 1];
+	memset(lines, 0, sizeof(lines));
+
+	const u32 fileKiB = (meta->fileSize + 1023) / 1024;
+	const u32 srcKiB = (meta->srcSize + 1023) / 1024;
+	const u32 dstKiB = (meta->dstSize + 1023) / 1024;
+	switch(meta->format)
+	{
+		case PATCH_FMT_IPS:
+			ee_snprintf(lines[0], SCREEN_COLS + 1, "IPS, %lu KiB, %lu records", fileKiB, meta->records);
+			ee_snprintf(lines[1], SCREEN_COLS + 1, "Output: %s%lu KiB",
+			            (meta->flags & PATCH_META_DST_MIN ? ">= " : ""), dstKiB);
+			ee_snprintf(lines[2], SCREEN_COLS + 1, "No checksums");
+			break;
+		case PATCH_FMT_UPS:
+			ee_snprintf(lines[0], SCREEN_COLS + 1, "UPS, %lu KiB", fileKiB);
+			ee_snprintf(lines[1], SCREEN_COLS + 1, "Input: %lu KiB, output: %lu KiB", srcKiB, dstKiB);
+			ee_snprintf(lines[2], SCREEN_COLS + 1, "CRC32: %08lX -> %08lX", meta->srcCrc, meta->dstCrc);
+			break;
+		default:
+			ee_snprintf(lines[0], SCREEN_COLS + 1, "Not a valid IPS/UPS patch");
+	}
+
+	for(u32 i = 0; i < PATCH_META_ROWS; i++)
+	{
+		// Pad with spaces to overwrite the previous summary.
+		const u32 len = strlen(lines[i]);
+		memset(&lines[i][len], ' ', SCREEN_COLS - len);
+		lines[i][SCREEN_COLS] = '\0';
+
+		ee_printf("\x1b[%lu;H\x1b[36m%s", SCREEN_ROWS - PATCH_META_ROWS + i, lines[i]);
+	}
+}
@@ -0,0 +1,62 @@
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "drivers/lgy.h"
+#include "arm11/crc32.h"
+#include "arm11/rom_info.h"
+
+
+Result romInfoInit(const char *const romPath, RomInfo *const rom)
+{
+	FILINFO fi;
+	const Result res = fStat(romPath, &fi);
+	if(res != RES_OK) return res;
+
+	rom->size = fi.fsize;
+	rom->fdate = fi.fdate;
+	rom->ftime = fi.ftime;
+	rom->crc = 0;
+	rom->crcValid = false;
+
+	return RES_OK;
+}
+
+void romInfoAdopt(RomInfo *const rom, const RomInfo *const cached)
+{
+	if(!rom->crcValid && cached->crcValid && cached->size == rom->size &&
+	   cached->fdate == rom->fdate && cached->ftime == rom->ftime)
+	{
+		rom->crc = cached->crc;
+		rom->crcValid = true;
+	}
+}
+
+bool romInfoCrc(RomInfo *const rom)
+{
+	if(rom->crcValid || rom->size > MAX_ROM_SIZE) return false;
+
+	rom->crc = crc32(0, (const void*)ROM_LOC, rom->size);
+	rom->crcValid = true;
+	debug_printf("ROM CRC32: %08lX\n", rom->crc);
+
+	return true;
+}
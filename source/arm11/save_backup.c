@@ -0,0 +1,254 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "util.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "drivers/sha.h"
+#include "arm11/fmt.h"
+#include "arm11/arena.h"
+#include "arm11/fs_contig.h"
+#include "arm11/save_backup.h"
+
+
+#define OBJECT_DIR     SAVE_BACKUP_DIR "/objects"
+#define MAX_SAVE_SIZE  (1024u * 128) // Flash 1m.
+#define HASH_STR_LEN   (40u)         // SHA1 in hex without null terminator.
+#define IDX_LINE_LEN   (HASH_STR_LEN + 1)
+#define IDX_BUF_SIZE   (IDX_LINE_LEN * MAX_BACKUP_DEPTH + 1)
+#define SCAN_BLOCKS    (10u)
+
+
+static void hash2Str(const u32 hash[5], char str[HASH_STR_LEN + 1])
+{
+	static const char hexDigits[16] = "0123456789ABCDEF";
+	const u8 *const bytes = (const u8*)hash;
+	for(u32 i = 0; i < 20; i++)
+	{
+		str[i * 2]     = hexDigits[bytes[i]>>4];
+		str[i * 2 + 1] = hexDigits[bytes[i] & 15u];
+	}
+	str[HASH_STR_LEN] = '\0';
+}
+
+static bool isHexDigit(const char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F');
+}
+
+// Saves outside of the saves folder (patches) get a hash
+// of their folder as prefix to avoid name collisions.
+// Shard folders (see save_shard.h) count as the saves folder.
+static void makeIndexPath(const char *const savePath, char idxPath[512])
+{
+	const char *name = strrchr(savePath, '/');
+	name = (name == NULL ? savePath : name + 1);
+
+	bool inSaveDir = strncmp(savePath, "saves/", 6) == 0;
+	if(inSaveDir)
+	{
+		const char *rel = savePath + 6;
+		if(isHexDigit(rel[0]) && isHexDigit(rel[1]) && rel[2] == '/') rel += 3;
+		inSaveDir = strchr(rel, '/') == NULL;
+	}
+
+	if(inSaveDir)
+		ee_snprintf(idxPath, 512, SAVE_BACKUP_DIR "/%.400s.idx", name);
+	else
+	{
+		u32 fnv = 2166136261u; // FNV-1a.
+		for(const char *p = savePath; p < name; p++) fnv = (fnv ^ (u8)*p) * 16777619u;
+		ee_snprintf(idxPath, 512, SAVE_BACKUP_DIR "/%08lX_%.400s.idx", fnv, name);
+	}
+}
+
+// Returns the number of hashes in the index.
+static u32 loadIndex(const char *const idxPath, char idx[IDX_BUF_SIZE])
+{
+	memset(idx, 0, IDX_BUF_SIZE);
+	if(fsQuickRead(idxPath, idx, IDX_BUF_SIZE - 1) != RES_OK) return 0;
+
+	u32 num = 0;
+	while(num < MAX_BACKUP_DEPTH && strlen(&idx[num * IDX_LINE_LEN]) >= IDX_LINE_LEN &&
+	      idx[num * IDX_LINE_LEN + HASH_STR_LEN] == '\n')
+	{
+		num++;
+	}
+
+	return num;
+}
+
+static Result storeObject(const char *const hashStr, const void *const buf, const u32 size)
+{
+	char path[96];
+	ee_snprintf(path, sizeof(path), OBJECT_DIR "/%s.sav", hashStr);
+
+	// Already stored by another slot/game or an earlier launch.
+	FILINFO fi;
+	Result res = fStat(path, &fi);
+	if(res == RES_OK && fi.fsize == size) return RES_OK;
+
+	if((res = fsMakePath(OBJECT_DIR)) != RES_OK && res != RES_FR_EXIST) return res;
+
+	// Write to a temporary file first so a power loss never
+	// leaves a truncated object with a valid name behind.
+	char tmpPath[96];
+	ee_snprintf(tmpPath, sizeof(tmpPath), OBJECT_DIR "/%s.tmp", hashStr);
+	if((res = fsQuickWriteContig(tmpPath, buf, size)) != RES_OK) return res;
+	fUnlink(path);
+
+	return fRename(tmpPath, path);
+}
+
+static bool isReferenced(const char *const hashStr, Arena *const arena)
+{
+	const ArenaMark mark = arenaMark(arena);
+	FILINFO *const fis = (FILINFO*)arenaAlloc(arena, sizeof(FILINFO) * SCAN_BLOCKS);
+	char *const idx = (char*)arenaAlloc(arena, IDX_BUF_SIZE);
+	char *const path = (char*)arenaAlloc(arena, 512);
+	if(fis == NULL || idx == NULL || path == NULL)
+	{
+		arenaReset(arena, mark);
+		return true; // Don't delete anything if we can't check.
+	}
+
+	bool found = false;
+	DHandle dh;
+	if(fOpenDir(&dh, SAVE_BACKUP_DIR) == RES_OK)
+	{
+		u32 read;
+		do
+		{
+			if(fReadDir(dh, fis, SCAN_BLOCKS, &read) != RES_OK)
+			{
+				found = true;
+				break;
+			}
+
+			for(u32 i = 0; i < read && !found; i++)
+			{
+				const u32 nameLen = strlen(fis[i].fname);
+				if(fis[i].fattrib & AM_DIR || nameLen < 4 || strcmp(fis[i].fname + nameLen - 4, ".idx") != 0)
+					continue;
+
+				ee_snprintf(path, 512, SAVE_BACKUP_DIR "/%s", fis[i].fname);
+				const u32 num = loadIndex(path, idx);
+				for(u32 e = 0; e < num; e++)
+				{
+					if(memcmp(&idx[e * IDX_LINE_LEN], hashStr, HASH_STR_LEN) == 0)
+					{
+						found = true;
+						break;
+					}
+				}
+			}
+		} while(!found && read == SCAN_BLOCKS);
+
+		fCloseDir(dh);
+	}
+	else found = true;
+
+	arenaReset(arena, mark);
+
+	return found;
+}
+
+Result backupSave(const char *const savePath, u8 depth, Arena *const arena)
+{
+	if(depth == 0 || *savePath == '\0') return RES_OK;
+	if(depth > MAX_BACKUP_DEPTH) depth = MAX_BACKUP_DEPTH;
+
+	const ArenaMark mark = arenaMark(arena);
+	u32 *const buf = (u32*)arenaAlloc(arena, MAX_SAVE_SIZE);
+	char *const idx = (char*)arenaAlloc(arena, IDX_BUF_SIZE);
+	char *const newIdx = (char*)arenaCalloc(arena, IDX_BUF_SIZE);
+	char *const idxPath = (char*)arenaAlloc(arena, 512);
+	if(buf == NULL || idx == NULL || newIdx == NULL || idxPath == NULL)
+	{
+		arenaReset(arena, mark);
+		return RES_OUT_OF_MEM;
+	}
+
+	Result res;
+	do
+	{
+		// Nothing to back up for new games.
+		FHandle f;
+		if((res = fOpen(&f, savePath, FA_OPEN_EXISTING | FA_READ)) != RES_OK)
+		{
+			if(res == RES_FR_NO_FILE) res = RES_OK;
+			break;
+		}
+		const u32 size = fSize(f);
+		if(size == 0 || size > MAX_SAVE_SIZE)
+		{
+			fClose(f);
+			break;
+		}
+		res = fRead(f, buf, size, NULL);
+		fClose(f);
+		if(res != RES_OK) break;
+
+		u32 hash[5];
+		char hashStr[HASH_STR_LEN + 1];
+		sha(buf, size, hash, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
+		hash2Str(hash, hashStr);
+
+		// Unchanged since the last backup. Costs only the hash.
+		makeIndexPath(savePath, idxPath);
+		const u32 num = loadIndex(idxPath, idx);
+		if(num > 0 && memcmp(idx, hashStr, HASH_STR_LEN) == 0) break;
+
+		if((res = storeObject(hashStr, buf, size)) != RES_OK) break;
+
+		// Put the new hash in front and drop duplicates.
+		u32 newNum = 0;
+		memcpy(newIdx, hashStr, HASH_STR_LEN);
+		newIdx[HASH_STR_LEN] = '\n';
+		newNum++;
+		u32 e = 0;
+		for(; e < num && newNum < depth; e++)
+		{
+			const char *const entry = &idx[e * IDX_LINE_LEN];
+			if(memcmp(entry, hashStr, HASH_STR_LEN) == 0) continue;
+			memcpy(&newIdx[newNum * IDX_LINE_LEN], entry, IDX_LINE_LEN);
+			newNum++;
+		}
+		if((res = fsQuickWrite(idxPath, newIdx, newNum * IDX_LINE_LEN)) != RES_OK) break;
+
+		// Delete rotated out objects nobody else references.
+		for(; e < num; e++)
+		{
+			char dropped[HASH_STR_LEN + 1];
+			memcpy(dropped, &idx[e * IDX_LINE_LEN], HASH_STR_LEN);
+			dropped[HASH_STR_LEN] = '\0';
+			if(strcmp(dropped, hashStr) == 0 || isReferenced(dropped, arena)) continue;
+
+			char objPath[96];
+			ee_snprintf(objPath, sizeof(objPath), OBJECT_DIR "/%s.sav", dropped);
+			fUnlink(objPath);
+		}
+	} while(0);
+
+	arenaReset(arena, mark);
+
+	return res;
+}
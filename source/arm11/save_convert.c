@@ -0,0 +1,189 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "oaf_error_codes.h"
+#include "fs.h"
+#include "drivers/lgy.h"
+#include "arm11/arena.h"
+#include "arm11/save_convert.h"
+
+
+#define CHUNK_SIZE      (1024u * 4)
+#define MAX_FOOTER_SIZE (0x100u) // RTC and other emulator footers.
+
+
+u32 saveTypeSize(u16 saveType)
+{
+	saveType &= SAVE_TYPE_MASK;
+	if(saveType < SAVE_TYPE_EEPROM_64k)         return 0x200;   // 4 Kbit.
+	if(saveType < SAVE_TYPE_FLASH_512k_AML_RTC) return 0x2000;  // 64 Kbit.
+	if(saveType < SAVE_TYPE_FLASH_1m_MRX_RTC)   return 0x10000; // 512 Kbit.
+	if(saveType < SAVE_TYPE_SRAM_256k)          return 0x20000; // 1 Mbit.
+	if(saveType == SAVE_TYPE_SRAM_256k)         return 0x8000;  // 256 Kbit.
+
+	return 0;
+}
+
+// Checks if everything after expected can be discarded.
+static Result checkTail(const FHandle f, const u32 expected, const u32 size, u8 *const buf, bool *const disposable)
+{
+	*disposable = true;
+	if(size - expected <= MAX_FOOTER_SIZE) return RES_OK;
+
+	// Either erased/zero filled padding or repeats of the save (mirroring).
+	// Chunks never cross a multiple of expected (all sizes are powers of 2).
+	const u32 chunkSize = (expected < CHUNK_SIZE ? expected : CHUNK_SIZE);
+	u8 *const mirrorBuf = buf + CHUNK_SIZE;
+	bool erased = true;
+	bool zero = true;
+	bool mirror = size % expected == 0;
+	Result res = RES_OK;
+	for(u32 pos = expected; pos < size && (erased || zero || mirror); pos += chunkSize)
+	{
+		const u32 len = (size - pos < chunkSize ? size - pos : chunkSize);
+		if((res = fLseek(f, pos)) != RES_OK) break;
+		if((res = fRead(f, buf, len, NULL)) != RES_OK) break;
+
+		for(u32 i = 0; i < len; i++)
+		{
+			erased &= buf[i] == 0xFF;
+			zero &= buf[i] == 0;
+		}
+
+		if(mirror)
+		{
+			if((res = fLseek(f, pos % expected)) != RES_OK) break;
+			if((res = fRead(f, mirrorBuf, len, NULL)) != RES_OK) break;
+			mirror = memcmp(buf, mirrorBuf, len) == 0;
+		}
+	}
+
+	*disposable = erased || zero || mirror;
+
+	return res;
+}
+
+u16 saveTypeFromSave(const char *const savePath, u32 romSize, Arena *const arena)
+{
+	FHandle f;
+	if(fOpen(&f, savePath, FA_OPEN_EXISTING | FA_READ) != RES_OK) return 0xFF;
+
+	// Ignore emulator footers.
+	u32 size = fSize(f);
+	if(size > 0x200) size = 1u<<(31 - __builtin_clz(size));
+	if(fSize(f) - size > MAX_FOOTER_SIZE) size = 0;
+
+	// Sizes shared by 2 save types if the smaller one was padded.
+	u16 saveType = 0xFF;
+	u32 smaller = 0;
+	switch(size)
+	{
+		case 0x200:
+			saveType = SAVE_TYPE_EEPROM_8k;
+			break;
+		case 0x2000:
+			saveType = SAVE_TYPE_EEPROM_64k;
+			smaller = 0x200;
+			break;
+		case 0x8000:
+			saveType = SAVE_TYPE_SRAM_256k;
+			break;
+		case 0x10000:
+			saveType = SAVE_TYPE_FLASH_512k_PSC_RTC;
+			smaller = 0x8000;
+			break;
+		case 0x20000:
+			saveType = SAVE_TYPE_FLASH_1m_MRX_RTC;
+			smaller = 0x10000;
+			break;
+	}
+
+	if(smaller != 0)
+	{
+		const ArenaMark mark = arenaMark(arena);
+		u8 *const buf = (u8*)arenaAlloc(arena, CHUNK_SIZE * 2);
+		bool padded = true;
+		if(buf == NULL || checkTail(f, smaller, size, buf, &padded) != RES_OK || padded)
+			saveType = 0xFF;
+		arenaReset(arena, mark);
+	}
+	fClose(f);
+
+	// Same as the SDK string scan. EEPROM is addressed differently with ROMs bigger than 16 MiB.
+	if(saveType < SAVE_TYPE_FLASH_512k_AML_RTC && romSize > 0x1000000) saveType++;
+
+	return saveType;
+}
+
+Result convertSave(const char *const savePath, u16 saveType, Arena *const arena)
+{
+	const u32 expected = saveTypeSize(saveType);
+	if(expected == 0 || *savePath == '\0') return RES_OK;
+
+	FHandle f;
+	Result res = fOpen(&f, savePath, FA_OPEN_EXISTING | FA_READ | FA_WRITE);
+	if(res == RES_FR_NO_FILE) return RES_OK; // New save.
+	if(res != RES_OK) return res;
+
+	const u32 size = fSize(f);
+	if(size == expected || size == 0)
+	{
+		fClose(f);
+		return RES_OK;
+	}
+
+	const ArenaMark mark = arenaMark(arena);
+	u8 *const buf = (u8*)arenaAlloc(arena, CHUNK_SIZE * 2);
+	if(buf != NULL)
+	{
+		if(size < expected)
+		{
+			// Pad with erased flash/EEPROM state.
+			memset(buf, 0xFF, CHUNK_SIZE);
+			if((res = fLseek(f, size)) == RES_OK)
+			{
+				for(u32 pos = size; pos < expected; pos += CHUNK_SIZE)
+				{
+					const u32 len = (expected - pos < CHUNK_SIZE ? expected - pos : CHUNK_SIZE);
+					if((res = fWrite(f, buf, len, NULL)) != RES_OK) break;
+				}
+			}
+		}
+		else
+		{
+			bool disposable;
+			if((res = checkTail(f, expected, size, buf, &disposable)) == RES_OK)
+			{
+				if(disposable)
+				{
+					if((res = fLseek(f, expected)) == RES_OK) res = fTruncate(f);
+				}
+				else res = RES_SAVE_SIZE_MISMATCH;
+			}
+		}
+	}
+	else res = RES_OUT_OF_MEM;
+
+	arenaReset(arena, mark);
+
+	const Result closeRes = fClose(f);
+
+	return (res == RES_OK ? closeRes : res);
+}
@@ -0,0 +1,127 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "oaf_error_codes.h"
+#include "drivers/lgy.h"
+#include "kernel.h"
+#include "kevent.h"
+#include "arm11/drivers/codec.h"
+#include "arm11/fmt.h"
+#include "arm11/save_flush.h"
+
+
+// Lower than gbaGfxHandler() (3) so frames never wait for the SD card.
+#define FLUSH_TASK_PRIO  (1u)
+#define GBA_FPS          (60u) // Close enough (59.7275).
+
+
+typedef enum
+{
+	FLUSH_PAUSE = 0u, // Pause the GBA for the copy.
+	FLUSH_SLEEP = 1u  // The GBA is already asleep.
+} FlushKind;
+
+static KHandle g_flushEvent = 0;
+static u32 g_intervalFrames = 0;
+static u32 g_frameCount = 0;
+static volatile u8 g_flushKind = FLUSH_PAUSE;
+static volatile bool g_flushBusy = false;
+
+
+static void saveFlushTask(void *args)
+{
+	const KHandle event = (KHandle)args;
+
+	while(1)
+	{
+		if(waitForEvent(event) != KRES_OK) break;
+		clearEvent(event);
+
+		// The GBA must not run while the ARM9 copies the save memory to
+		// the .sav file or the copy can catch half of a save write.
+		// gbaGfxHandler() doesn't sleep or wake the GBA while this runs.
+		const bool pause = g_flushKind == FLUSH_PAUSE;
+		if(pause)
+		{
+			// Muted like for sleep so the audio doesn't buzz.
+			CODEC_muteI2S();
+			LGY_sleepGba();
+		}
+
+		const Result res = LGY_backupGbaSave();
+		if(res != RES_OK) debug_printf("Save flush failed: %s\n", oafResult2String(res));
+
+		if(pause)
+		{
+			LGY_wakeGba();
+			CODEC_unmuteI2S();
+		}
+
+		g_flushBusy = false;
+	}
+
+	taskExit();
+}
+
+static void startFlush(const FlushKind kind)
+{
+	g_frameCount = 0;
+	g_flushKind = kind;
+	g_flushBusy = true;
+	signalEvent(g_flushEvent, false);
+}
+
+void saveFlushInit(u16 interval)
+{
+	const KHandle event = createEvent(false);
+	g_intervalFrames = (u32)interval * GBA_FPS;
+	g_frameCount = 0;
+	g_flushBusy = false;
+	createTask(0x800, FLUSH_TASK_PRIO, saveFlushTask, (void*)event);
+	g_flushEvent = event;
+}
+
+void saveFlushFrame(void)
+{
+	if(g_flushEvent == 0 || g_intervalFrames == 0 || g_flushBusy) return;
+	if(++g_frameCount < g_intervalFrames) return;
+
+	startFlush(FLUSH_PAUSE);
+}
+
+void saveFlushSleep(void)
+{
+	if(g_flushEvent == 0 || g_flushBusy) return;
+
+	startFlush(FLUSH_SLEEP);
+}
+
+bool saveFlushBusy(void)
+{
+	return g_flushBusy;
+}
+
+void saveFlushDeinit(void)
+{
+	if(g_flushEvent != 0)
+	{
+		deleteEvent(g_flushEvent); // saveFlushTask() will automatically terminate.
+		g_flushEvent = 0;
+	}
+}
@@ -0,0 +1,173 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "arm11/fmt.h"
+#include "arm11/arena.h"
+#include "arm11/save_shard.h"
+
+
+#define SAVE_DIR     "saves"
+#define SCAN_BLOCKS  (10u)
+
+
+static bool g_sharded = false;
+
+
+
+// FNV-1a of the name up to the first dot. 256 shards.
+static u8 shardOf(const char *name)
+{
+	u32 fnv = 2166136261u;
+	for(; *name != '\0' && *name != '.'; name++) fnv = (fnv ^ (u8)*name) * 16777619u;
+
+	return (u8)(fnv ^ fnv>>8 ^ fnv>>16 ^ fnv>>24);
+}
+
+static bool isGameFile(const char *const name)
+{
+	const u32 len = strlen(name);
+	if(len < 5 || *name == '.') return false;
+
+	const char *const ext = name + len - 4;
+	return strcmp(ext, ".ini") == 0 || strcmp(ext, ".sav") == 0 ||
+	       (len > 6 && strcmp(name + len - 6, ".slots") == 0);
+}
+
+static Result moveToShard(const char *const name)
+{
+	char dir[12];
+	ee_snprintf(dir, sizeof(dir), SAVE_DIR "/%02X", shardOf(name));
+	Result res = fMkdir(dir);
+	if(res != RES_OK && res != RES_FR_EXIST) return res;
+
+	char oldPath[288];
+	char newPath[288];
+	ee_snprintf(oldPath, sizeof(oldPath), SAVE_DIR "/%s", name);
+	ee_snprintf(newPath, sizeof(newPath), "%s/%s", dir, name);
+
+	// Never overwrite a file already in the shard.
+	return fRename(oldPath, newPath);
+}
+
+static Result migrate(Arena *const arena)
+{
+	const ArenaMark mark = arenaMark(arena);
+	FILINFO *const fis = (FILINFO*)arenaAlloc(arena, sizeof(FILINFO) * SCAN_BLOCKS);
+	if(fis == NULL) return RES_OUT_OF_MEM;
+
+	DHandle dh;
+	Result res;
+	u32 moved = 0;
+	if((res = fOpenDir(&dh, SAVE_DIR)) == RES_OK)
+	{
+		// Renaming only marks the old entries as deleted so reading on is fine.
+		u32 read;
+		do
+		{
+			if((res = fReadDir(dh, fis, SCAN_BLOCKS, &read)) != RES_OK) break;
+
+			for(u32 i = 0; i < read; i++)
+			{
+				if(fis[i].fattrib & AM_DIR || !isGameFile(fis[i].fname)) continue;
+
+				res = moveToShard(fis[i].fname);
+				if(res == RES_FR_EXIST)
+				{
+					debug_printf("Shard conflict: %s\n", fis[i].fname);
+					res = RES_OK;
+				}
+				if(res != RES_OK) break;
+				moved++;
+			}
+		} while(res == RES_OK && read == SCAN_BLOCKS);
+
+		fCloseDir(dh);
+	}
+
+	arenaReset(arena, mark);
+	debug_printf("Moved %lu files into shards.\n", moved);
+
+	// Create the marker last so an interrupted migration is resumed.
+	if(res == RES_OK) res = fsQuickWrite(SAVE_SHARD_MARKER, "", 0);
+
+	return res;
+}
+
+Result saveShardInit(bool enable, Arena *const arena)
+{
+	FILINFO fi;
+	if(fStat(SAVE_SHARD_MARKER, &fi) == RES_OK)
+	{
+		g_sharded = true;
+		return RES_OK;
+	}
+	if(!enable) return RES_OK;
+
+	const Result res = migrate(arena);
+	g_sharded = res == RES_OK;
+
+	return res;
+}
+
+void saveShardPath(char cfgPath[512])
+{
+	if(!g_sharded) return;
+
+	const char *name = strrchr(cfgPath, '/');
+	name = (name == NULL ? cfgPath : name + 1);
+
+	char dir[12];
+	ee_snprintf(dir, sizeof(dir), SAVE_DIR "/%02X", shardOf(name));
+	const Result res = fMkdir(dir);
+	if(res != RES_OK && res != RES_FR_EXIST) return;
+
+	char path[512];
+	ee_snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+	// Files copied into the flat folder after the migration.
+	// Only checked until the game has an ini or save in its shard.
+	FILINFO fi;
+	const u32 pathLen = strlen(path);
+	strcpy(path + pathLen - 4, ".sav");
+	if(fStat(path, &fi) != RES_OK)
+	{
+		strcpy(path + pathLen - 4, ".ini");
+		if(fStat(path, &fi) != RES_OK)
+		{
+			static const char *const exts[12] = {".ini", ".sav", ".1.sav", ".2.sav", ".3.sav", ".4.sav",
+			                                     ".5.sav", ".6.sav", ".7.sav", ".8.sav", ".9.sav", ".slots"};
+			char file[256];
+			const u32 stemLen = strlen(name) - 4;
+			for(u32 i = 0; i < 12 && stemLen + strlen(exts[i]) < sizeof(file); i++)
+			{
+				memcpy(file, name, stemLen);
+				strcpy(file + stemLen, exts[i]);
+				moveToShard(file);
+			}
+		}
+	}
+	strcpy(path + pathLen - 4, ".ini");
+
+	// Keep 2 chars free for gameCfg2SavePath().
+	if(pathLen < 512 - 2) strcpy(cfgPath, path);
+}
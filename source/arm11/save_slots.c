@@ -0,0 +1,169 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "error_codes.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "drivers/sha.h"
+#include "arm11/drivers/hid.h"
+#include "arm11/console.h"
+#include "arm11/fmt.h"
+#include "arm11/save_slots.h"
+#include "arm11/ui_input.h"
+
+
+#define MAX_SAVE_SIZE  (1024u * 128)
+
+
+// Same naming as gameCfg2SavePath(). ext replaces the last 4 chars of basePath.
+static bool makePath(const char *const basePath, const char *const ext, char out[512])
+{
+	const u32 baseLen = strlen(basePath);
+	if(baseLen < 4 || baseLen - 4 + strlen(ext) >= 512) return false;
+
+	memcpy(out, basePath, baseLen - 4);
+	strcpy(out + baseLen - 4, ext);
+
+	return true;
+}
+
+static bool makeSlotPath(const char *const basePath, const u8 slot, char out[512])
+{
+	char ext[7] = {'.', '0' + slot, '.', 's', 'a', 'v', '\0'};
+
+	return makePath(basePath, (slot == 0 ? ".sav" : ext), out);
+}
+
+static Result readSlotInfo(const char *const savePath, SaveSlotInfo *const info, const bool hash)
+{
+	memset(info, 0, sizeof(SaveSlotInfo));
+
+	FILINFO fi;
+	Result res = fStat(savePath, &fi);
+	if(res == RES_FR_NO_FILE) return RES_OK; // Empty slot.
+	if(res != RES_OK) return res;
+
+	info->size  = fi.fsize;
+	info->fdate = fi.fdate;
+	info->ftime = fi.ftime;
+	if(!hash || fi.fsize == 0 || fi.fsize > MAX_SAVE_SIZE) return RES_OK;
+
+	u32 *const buf = (u32*)malloc(fi.fsize);
+	if(buf == NULL) return RES_OUT_OF_MEM;
+	if((res = fsQuickRead(savePath, buf, fi.fsize)) == RES_OK)
+		sha(buf, fi.fsize, (u32*)info->sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
+	free(buf);
+
+	return res;
+}
+
+Result slotIndexLoad(const char *const basePath, SaveSlotIndex *const idx)
+{
+	char path[512];
+	if(!makePath(basePath, ".slots", path)) return RES_INVALID_ARG;
+
+	Result res = fsQuickRead(path, idx, sizeof(SaveSlotIndex));
+	if(res == RES_OK && idx->magic == SLOT_INDEX_MAGIC && idx->version == SLOT_INDEX_VERSION) return RES_OK;
+
+	// First use. Stat every slot once and hash the existing saves.
+	idx->magic   = SLOT_INDEX_MAGIC;
+	idx->version = SLOT_INDEX_VERSION;
+	for(u8 slot = 0; slot < NUM_SAVE_SLOTS; slot++)
+	{
+		char savePath[512];
+		if(!makeSlotPath(basePath, slot, savePath)) return RES_INVALID_ARG;
+		if((res = readSlotInfo(savePath, &idx->slots[slot], true)) != RES_OK) return res;
+	}
+
+	return fsQuickWrite(path, idx, sizeof(SaveSlotIndex));
+}
+
+Result slotIndexUpdate(const char *const basePath, const u8 slot)
+{
+	if(slot >= NUM_SAVE_SLOTS) return RES_INVALID_ARG;
+
+	// Games without an index never used the slot picker. Don't create one.
+	char idxPath[512];
+	if(!makePath(basePath, ".slots", idxPath)) return RES_INVALID_ARG;
+	SaveSlotIndex idx;
+	if(fsQuickRead(idxPath, &idx, sizeof(SaveSlotIndex)) != RES_OK ||
+	   idx.magic != SLOT_INDEX_MAGIC || idx.version != SLOT_INDEX_VERSION) return RES_OK;
+
+	char path[512];
+	if(!makeSlotPath(basePath, slot, path)) return RES_INVALID_ARG;
+	const Result res = readSlotInfo(path, &idx.slots[slot], true);
+	if(res != RES_OK) return res;
+
+	return fsQuickWrite(idxPath, &idx, sizeof(SaveSlotIndex));
+}
+
+u8 slotPicker(const SaveSlotIndex *const idx, const u8 currentSlot)
+{
+	consoleClear();
+	ee_puts("==Save Slot==\n");
+	for(u8 slot = 0; slot < NUM_SAVE_SLOTS; slot++)
+	{
+		const SaveSlotInfo *const info = &idx->slots[slot];
+		if(info->size == 0)
+		{
+			ee_printf(" %u  Empty\n", slot);
+			continue;
+		}
+
+		// FAT date/time format.
+		ee_printf(" %u  %04u-%02u-%02u %02u:%02u  %3lu KiB  %02X%02X%02X%02X\n", slot,
+		          (info->fdate>>9) + 1980, (info->fdate>>5) & 15u, info->fdate & 31u,
+		          info->ftime>>11, (info->ftime>>5) & 63u, (info->size + 1023) / 1024,
+		          info->sha1[0], info->sha1[1], info->sha1[2], info->sha1[3]);
+	}
+	ee_puts("\n"
+	        "=Controls=\n"
+	        "Up/Down: Navigate\n"
+	        "A: Select\n"
+	        "B: Keep slot from config");
+
+	u8 cursor = (currentSlot < NUM_SAVE_SLOTS ? currentSlot : 0);
+	u8 oldCursor = cursor;
+	u8 selected = currentSlot;
+	while(1)
+	{
+		ee_printf("\x1b[%u;H ", oldCursor + 2);
+		ee_printf("\x1b[%u;H>", cursor + 2);
+		oldCursor = cursor;
+
+		u32 kDown;
+		if(!uiWaitForKeys(&kDown)) goto end;
+
+		if(kDown & KEY_DUP)   cursor = (cursor > 0 ? cursor : NUM_SAVE_SLOTS) - 1;
+		if(kDown & KEY_DDOWN) cursor = (cursor + 1u) % NUM_SAVE_SLOTS;
+		if(kDown & KEY_B) break;
+		if(kDown & KEY_A)
+		{
+			selected = cursor;
+			break;
+		}
+	}
+
+end:
+	consoleClear();
+
+	return selected;
+}
@@ -0,0 +1,228 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "oaf_error_codes.h"
+#include "util.h"
+#include "arm11/fs_contig.h"
+#include "kernel.h"
+#include "kevent.h"
+#include "kmutex.h"
+#include "arm11/fmt.h"
+#include "arm11/sd_writer.h"
+
+
+// Lowest priority. Everything else including gbaGfxHandler() goes first.
+#define WRITER_TASK_PRIO  (1u)
+
+
+typedef struct
+{
+	char path[SD_WRITE_MAX_PATH];
+	void *data;        // NULL = free entry.
+	SdWriteDone done;  // NULL = data is freed.
+	u32 size;
+	u32 seq;    // Queue order within a priority.
+	u8 prio;
+} WriteEntry;
+
+static KHandle g_workEvent = 0;
+static KHandle g_idleEvent = 0;
+static KHandle g_mutex = 0;
+static volatile bool g_running = false;
+static u32 g_nextSeq = 0;
+static u32 g_pending = 0; // Queued + in progress.
+static WriteEntry g_queue[SD_WRITE_QUEUE_SIZE] = {0};
+
+
+
+// Mutex must be locked if the writer is running.
+static void releaseData(void *const data, const SdWriteDone done)
+{
+	if(done != NULL) done(data);
+	else             free(data);
+}
+
+// Mutex must be locked.
+static WriteEntry* nextEntry(void)
+{
+	WriteEntry *next = NULL;
+	for(u32 i = 0; i < SD_WRITE_QUEUE_SIZE; i++)
+	{
+		WriteEntry *const e = &g_queue[i];
+		if(e->data == NULL) continue;
+
+		if(next == NULL || e->prio > next->prio || (e->prio == next->prio && (s32)(e->seq - next->seq) < 0))
+			next = e;
+	}
+
+	return next;
+}
+
+static void writerTask(void *args)
+{
+	const KHandle event = (KHandle)args;
+
+	while(1)
+	{
+		if(waitForEvent(event) != KRES_OK) break;
+		clearEvent(event);
+
+		while(1)
+		{
+			// Take the entry out of the queue so a new write to
+			// the same file while this one runs is queued again.
+			lockMutex(g_mutex);
+			WriteEntry *const e = nextEntry();
+			WriteEntry cur;
+			if(e != NULL)
+			{
+				cur = *e;
+				e->data = NULL;
+			}
+			unlockMutex(g_mutex);
+			if(e == NULL) break;
+
+			const Result res = fsQuickWriteContig(cur.path, cur.data, cur.size);
+			if(res != RES_OK) debug_printf("Async write of %s failed: %s\n", cur.path, oafResult2String(res));
+
+			lockMutex(g_mutex);
+			releaseData(cur.data, cur.done);
+			if(--g_pending == 0) signalEvent(g_idleEvent, false);
+			unlockMutex(g_mutex);
+		}
+	}
+
+	taskExit();
+}
+
+void sdWriterInit(void)
+{
+	if(g_running) return;
+
+	g_mutex = createMutex();
+	g_idleEvent = createEvent(false);
+	signalEvent(g_idleEvent, false); // Nothing pending.
+	const KHandle event = createEvent(false);
+	createTask(0x800, WRITER_TASK_PRIO, writerTask, (void*)event);
+	g_workEvent = event;
+	g_running = true;
+}
+
+static Result queueWrite(const char *const path, void *const data, u32 size, SdWritePrio prio,
+                         const SdWriteDone done)
+{
+	if(!g_running || strlen(path) >= SD_WRITE_MAX_PATH)
+	{
+		const Result res = fsQuickWriteContig(path, data, size);
+		if(g_running) lockMutex(g_mutex);
+		releaseData(data, done);
+		if(g_running) unlockMutex(g_mutex);
+		return res;
+	}
+
+	lockMutex(g_mutex);
+
+	// Coalesce with a pending write to the same file or take a free entry.
+	WriteEntry *entry = NULL;
+	for(u32 i = 0; i < SD_WRITE_QUEUE_SIZE; i++)
+	{
+		WriteEntry *const e = &g_queue[i];
+		if(e->data != NULL && strcmp(e->path, path) == 0)
+		{
+			entry = e;
+			break;
+		}
+		if(e->data == NULL && entry == NULL) entry = e;
+	}
+
+	Result res = RES_OK;
+	if(entry != NULL)
+	{
+		if(entry->data != NULL)
+		{
+			releaseData(entry->data, entry->done);
+			if(prio < entry->prio) prio = entry->prio;
+		}
+		else
+		{
+			safeStrcpy(entry->path, path, SD_WRITE_MAX_PATH);
+			entry->seq = g_nextSeq++;
+			if(g_pending++ == 0) clearEvent(g_idleEvent);
+		}
+		entry->data = data;
+		entry->done = done;
+		entry->size = size;
+		entry->prio = prio;
+	}
+	else
+	{
+		res = RES_WRITE_QUEUE_FULL;
+		releaseData(data, done);
+	}
+
+	unlockMutex(g_mutex);
+
+	if(res == RES_OK) signalEvent(g_workEvent, false);
+
+	return res;
+}
+
+Result sdWriteAsync(const char *const path, void *const data, u32 size, SdWritePrio prio)
+{
+	return queueWrite(path, data, size, prio, NULL);
+}
+
+Result sdWriteAsyncBorrowed(const char *const path, const void *const data, u32 size, SdWritePrio prio,
+                            const SdWriteDone done)
+{
+	return queueWrite(path, (void*)data, size, prio, done);
+}
+
+Result sdWriteAsyncCopy(const char *const path, const void *const data, u32 size, SdWritePrio prio)
+{
+	void *const copy = malloc(size > 0 ? size : 1);
+	if(copy == NULL) return RES_OUT_OF_MEM;
+	memcpy(copy, data, size);
+
+	return sdWriteAsync(path, copy, size, prio);
+}
+
+void sdWriterFlush(void)
+{
+	if(!g_running) return;
+
+	// Wakes up the writer task if it has a lower priority.
+	waitForEvent(g_idleEvent);
+}
+
+void sdWriterDeinit(void)
+{
+	if(!g_running) return;
+
+	sdWriterFlush();
+	g_running = false;
+	deleteEvent(g_workEvent); // writerTask() will automatically terminate.
+	g_workEvent = 0;
+	deleteEvent(g_idleEvent);
+	g_idleEvent = 0;
+	deleteMutex(g_mutex);
+	g_mutex = 0;
+}
@@ -0,0 +1,66 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/keymap.h"
+#include "arm11/turbo.h"
+
+
+static u8 g_turboRates[32] = {0}; // 0 = off.
+
+u32 g_turboLut[TURBO_CYCLE] = {0};
+volatile u8 g_turboPhase = 0;
+bool g_turboActive = false;
+
+
+
+bool turboParse(const char *const name, const char *const value)
+{
+	if(strncmp(name, "TURBO_", 6) != 0) return false;
+
+	const s8 bit = keymapKeyBit(name + 6);
+	const u32 rate = strtoul(value, NULL, 10);
+	if(bit < 0 || rate > TURBO_MAX_RATE) return false;
+
+	g_turboRates[bit] = rate;
+
+	return true;
+}
+
+void turboCompile(void)
+{
+	bool active = false;
+	for(u32 frame = 0; frame < TURBO_CYCLE; frame++)
+	{
+		// Pressed for rate frames, then released for rate frames.
+		u32 offMask = 0;
+		for(u32 bit = 0; bit < 32; bit++)
+		{
+			const u32 rate = g_turboRates[bit];
+			if(rate != 0 && frame % (rate * 2) >= rate) offMask |= 1u<<bit;
+		}
+
+		g_turboLut[frame] = offMask;
+		active |= offMask != 0;
+	}
+
+	g_turboActive = active;
+	g_turboPhase = 0;
+}
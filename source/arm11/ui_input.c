@@ -0,0 +1,74 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "fs.h"
+#include "drivers/gfx.h"
+#include "arm11/drivers/hid.h"
+#include "arm11/drivers/codec.h"
+#include "arm11/power.h"
+#include "arm11/sd_writer.h"
+#include "arm11/ui_input.h"
+
+
+
+bool uiWaitForKeys(u32 *const kDown)
+{
+	u32 down;
+	do
+	{
+		// Blocks on the VBlank event. The ARM11 idles until the next VBlank IRQ.
+		GFX_waitForVBlank0();
+
+		hidScanInput();
+		if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) return false;
+		down = hidKeysDown();
+	} while(down == 0);
+
+	*kDown = down;
+
+	return true;
+}
+
+void uiWaitForCombo(u32 combo)
+{
+	while(1)
+	{
+		u32 kDown;
+		if(!uiWaitForKeys(&kDown)) uiPowerOff();
+		if(hidKeysHeld() == combo && (kDown & combo) != 0) break;
+	}
+}
+
+void uiWaitForPowerOff(void)
+{
+	u32 kDown;
+	while(uiWaitForKeys(&kDown));
+
+	uiPowerOff();
+}
+
+void uiPowerOff(void)
+{
+	sdWriterFlush();
+	CODEC_deinit();
+	GFX_deinit();
+	fUnmount(FS_DRIVE_SDMC);
+
+	power_off();
+}
@@ -30,7 +30,9 @@ const char* oafResult2String(Result res)
 	static const char *const oafResultStrings[] =
 	{
 		"ROM too big. Max 32 MiB",
-		"Invalid patch file"
+		"Invalid patch file",
+		"Save size doesn't match the save type",
+		"SD card write queue full"
 	};
 
 	return (res < CUSTOM_ERR_OFFSET ? result2String(res) : oafResultStrings[res - CUSTOM_ERR_OFFSET]);
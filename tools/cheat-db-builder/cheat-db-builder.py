@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+
+# open_agb_firm cheats.bin builder
+#
+# Packs cheat text files into a cheats.bin database for open_agb_firm (see include/arm11/cheat_db.h).
+# Each input file holds the cheats of one game and is named after the game code, optionally followed
+# by the CRC32 of the ROM for revision specific cheats:
+#   AXVE.cht           Cheats for all revisions of AXVE.
+#   AXVE-F0815EE7.cht  Cheats only for the ROM with this CRC32 (as listed in No-Intro DATs).
+#
+# Two formats are accepted:
+#   open_agb_firm .cht files (one [section] per cheat with enabled= and code= lines).
+#   RetroArch .cht files (cheats = N, cheatN_desc, cheatN_code, cheatN_enable). Multiple codes are
+#   separated by '+'.
+#
+# Only cheats the firmware can apply (ROM writes) are kept. Everything else is reported and dropped.
+#
+# Usage: cheat-db-builder.py <input folder> <cheats.bin>
+
+import os
+import re
+import struct
+import sys
+
+DB_MAGIC = 0x4244434F # "OCDB"
+DB_VERSION = 1
+MAX_ENTRIES = 8192
+MAX_CHEATS_SIZE = 1024 * 32 # Per game code
+MAX_MATCHES = 64 # Entries per game code
+MAX_NAME_LEN = 63
+ROM_START = 0x08000000
+MAX_ROM_SIZE = 0x2000000
+
+NAME_PATTERN = re.compile(r'^([A-Z0-9]{4})(?:-([0-9A-Fa-f]{8}))?\.cht$')
+
+# Normalize a code to a format parseCode() in source/arm11/cheats.c accepts or return None
+def normalizecode(code):
+    code = code.strip().upper()
+
+    m = re.fullmatch(r'([0-9A-F]{8}):([0-9A-F]{2}|[0-9A-F]{4}|[0-9A-F]{8})', code)
+    if m:
+        addr = int(m.group(1), 16)
+        size = len(m.group(2)) // 2
+        if addr < ROM_START or addr + size > ROM_START + MAX_ROM_SIZE:
+            return None
+        return code
+
+    # GameShark v1/v2 ROM patch. Also without the space.
+    m = re.fullmatch(r'(6[0-9A-F]{7}) ?([0-3]000[0-9A-F]{4})', code)
+    if m:
+        if (int(m.group(1), 16) & 0x0FFFFFFF) * 2 + 2 > MAX_ROM_SIZE:
+            return None
+        return m.group(1) + ' ' + m.group(2)
+
+    return None
+
+# Returns a list of (name, enabled, [codes])
+def parseoaf(lines):
+    cheats = []
+    for line in lines:
+        line = line.strip()
+        if not line or line[0] in ';#':
+            continue
+        if line.startswith('[') and line.endswith(']'):
+            cheats.append([line[1:-1].strip(), False, []])
+        elif '=' in line and cheats:
+            key, value = [s.strip() for s in line.split('=', 1)]
+            if key == 'enabled':
+                cheats[-1][1] = value == 'true'
+            elif key == 'code':
+                cheats[-1][2].append(value)
+
+    return cheats
+
+def parseretroarch(lines):
+    values = {}
+    for line in lines:
+        if '=' in line:
+            key, value = [s.strip() for s in line.split('=', 1)]
+            values[key] = value.strip('"')
+
+    cheats = []
+    for i in range(int(values.get('cheats', '0'))):
+        name = values.get('cheat%d_desc' % i, 'Cheat %d' % i)
+        enabled = values.get('cheat%d_enable' % i, 'false') == 'true'
+        codes = [c for c in values.get('cheat%d_code' % i, '').split('+') if c.strip()]
+        cheats.append([name, enabled, codes])
+
+    return cheats
+
+# Convert the cheats of one file to the .cht text the firmware parses
+def buildcheats(path):
+    with open(path, 'r', encoding='utf-8', errors='replace') as f:
+        lines = f.read().splitlines()
+
+    if any(re.match(r'\s*cheats\s*=', l) for l in lines):
+        cheats = parseretroarch(lines)
+    else:
+        cheats = parseoaf(lines)
+
+    text = ''
+    dropped = 0
+    names = set()
+    for name, enabled, codes in cheats:
+        # Brackets would end the section early. Names must be unique.
+        # The firmware stores MAX_NAME_LEN bytes. Cut at a character boundary.
+        name = name.replace('[', '(').replace(']', ')')
+        name = name.encode()[:MAX_NAME_LEN].decode(errors='ignore')
+        codes = [normalizecode(c) for c in codes]
+        if not codes or None in codes or name in names:
+            dropped += 1
+            continue
+
+        names.add(name)
+        text += '[%s]\nenabled=%s\n' % (name, 'true' if enabled else 'false')
+        for c in codes:
+            text += 'code=%s\n' % c
+
+    return text.encode() + b'\x00', len(names), dropped
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('Usage: cheat-db-builder.py <input folder> <cheats.bin>')
+
+    entries = []
+    totalkept = totaldropped = 0
+    for filename in sorted(os.listdir(sys.argv[1])):
+        m = NAME_PATTERN.match(filename)
+        if not m:
+            print('Skipping %s (not <game code>[-<CRC32>].cht)' % filename)
+            continue
+
+        data, kept, dropped = buildcheats(os.path.join(sys.argv[1], filename))
+        totalkept += kept
+        totaldropped += dropped
+        if dropped:
+            print('%s: Dropped %d cheat(s) with unsupported codes' % (filename, dropped))
+        if kept == 0:
+            continue
+
+        gamecode = int.from_bytes(m.group(1).encode(), 'little') # As read from 0xAC in the ROM
+        romcrc = int(m.group(2), 16) if m.group(2) else 0
+        entries.append((gamecode, romcrc, data))
+
+    # Same order as the binary search in source/arm11/cheat_db.c
+    entries.sort(key=lambda e: (e[0], e[1]))
+    if len(entries) > MAX_ENTRIES:
+        sys.exit('Error: Too many entries (%d, max %d).' % (len(entries), MAX_ENTRIES))
+
+    pergame = {}
+    for gamecode, romcrc, data in entries:
+        num, size = pergame.get(gamecode, (0, 0))
+        pergame[gamecode] = (num + 1, size + len(data))
+    for gamecode, (num, size) in pergame.items():
+        if size > MAX_CHEATS_SIZE:
+            sys.exit('Error: Cheats for %s are too big (%d bytes, max %d).' %
+                     (gamecode.to_bytes(4, 'little').decode(), size, MAX_CHEATS_SIZE))
+        if num > MAX_MATCHES:
+            sys.exit('Error: Too many revisions of %s (%d, max %d).' %
+                     (gamecode.to_bytes(4, 'little').decode(), num, MAX_MATCHES))
+
+    header = struct.pack('<IHHI', DB_MAGIC, DB_VERSION, 0, len(entries))
+    offset = len(header) + len(entries) * 16
+    index = b''
+    for gamecode, romcrc, data in entries:
+        index += struct.pack('<IIII', gamecode, romcrc, offset, len(data))
+        offset += len(data)
+
+    with open(sys.argv[2], 'wb') as f:
+        f.write(header)
+        f.write(index)
+        for e in entries:
+            f.write(e[2])
+
+    print('Wrote %d entries with %d cheats (%d dropped) to %s.' % (len(entries), totalkept, totaldropped, sys.argv[2]))
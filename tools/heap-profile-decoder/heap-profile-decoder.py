@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+
+# open_agb_firm heap profile decoder
+#
+# Decodes heap_profile.bin written by debug builds at exit (see include/arm11/heap_profile.h)
+# and symbolizes the allocation call sites.
+#
+# Usage: heap-profile-decoder.py heap_profile.bin <open_agb_firm11.elf|open_agb_firm11.map>
+#
+# With an ELF file arm-none-eabi-addr2line (from devkitARM, override with ADDR2LINE) is used
+# to get function, file and line. With a linker map file only the function is shown.
+
+import bisect
+import os
+import re
+import struct
+import subprocess
+import sys
+
+HEADER_FMT = '<IHHIIIIII'
+SITE_FMT = '<7I'
+MAGIC = 0x46525048 # "HPRF"
+VERSION = 1
+
+# Parse the binary report
+def readreport(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if len(data) < struct.calcsize(HEADER_FMT):
+        sys.exit('Error: Report is truncated.')
+    magic, version, numsites, totalallocs, totalbytes, livebytes, peaklivebytes, failedallocs, untracked = \
+        struct.unpack_from(HEADER_FMT, data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit('Error: Not a heap profile or unsupported version.')
+
+    header = {'totalallocs': totalallocs, 'totalbytes': totalbytes, 'livebytes': livebytes,
+              'peaklivebytes': peaklivebytes, 'failedallocs': failedallocs, 'untracked': untracked}
+
+    sites = []
+    offset = struct.calcsize(HEADER_FMT)
+    for i in range(numsites):
+        callsite, allocs, frees, sitebytes, livecount, sitelivebytes, sitepeakbytes = \
+            struct.unpack_from(SITE_FMT, data, offset)
+        offset += struct.calcsize(SITE_FMT)
+        sites.append({'callsite': callsite, 'allocs': allocs, 'frees': frees, 'totalbytes': sitebytes,
+                      'livecount': livecount, 'livebytes': sitelivebytes, 'peakbytes': sitepeakbytes})
+
+    return header, sites
+
+# Symbolize addresses with addr2line
+def symbolizeelf(elf, addrs):
+    addr2line = os.environ.get('ADDR2LINE', 'arm-none-eabi-addr2line')
+    # Return address - 1 points into the call instruction.
+    args = [addr2line, '-f', '-e', elf] + ['0x%X' % (a - 1) for a in addrs]
+    try:
+        out = subprocess.run(args, capture_output=True, text=True, check=True).stdout.splitlines()
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('Error: Failed to run %s: %s' % (addr2line, e))
+
+    syms = {}
+    for i, addr in enumerate(addrs):
+        func = out[i * 2] if i * 2 < len(out) else '??'
+        line = out[i * 2 + 1] if i * 2 + 1 < len(out) else '??:0'
+        syms[addr] = '%s (%s)' % (func, os.path.basename(line))
+
+    return syms
+
+# Symbolize addresses with the symbols from a GNU ld map file
+def symbolizemap(mapfile, addrs):
+    symlist = {}
+    sectionname = None
+    with open(mapfile, 'r', errors='replace') as f:
+        for line in f:
+            # Function sections (-ffunction-sections). Also catches static functions.
+            # The address is on the next line if the name is long.
+            m = re.match(r'^\s*\.text\.(\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x[0-9a-fA-F]+)?', line)
+            if m:
+                if m.group(2):
+                    symlist[int(m.group(2), 16)] = m.group(1)
+                    sectionname = None
+                else:
+                    sectionname = m.group(1)
+                continue
+            if sectionname:
+                m = re.match(r'^\s+0x([0-9a-fA-F]+)\s+0x[0-9a-fA-F]+', line)
+                if m:
+                    symlist[int(m.group(1), 16)] = sectionname
+                sectionname = None
+                continue
+
+            # Global symbols.
+            m = re.match(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_]\w*)\s*$', line)
+            if m:
+                symlist[int(m.group(1), 16)] = m.group(2)
+
+    starts = sorted(symlist)
+    syms = {}
+    for addr in addrs:
+        i = bisect.bisect_right(starts, addr - 1) - 1
+        if i < 0:
+            syms[addr] = '??'
+        else:
+            syms[addr] = '%s+0x%X' % (symlist[starts[i]], addr - starts[i])
+
+    return syms
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.exit('Usage: heap-profile-decoder.py heap_profile.bin [open_agb_firm11.elf|open_agb_firm11.map]')
+
+    header, sites = readreport(sys.argv[1])
+
+    addrs = [s['callsite'] for s in sites]
+    if len(sys.argv) >= 3 and sys.argv[2].endswith('.map'):
+        syms = symbolizemap(sys.argv[2], addrs)
+    elif len(sys.argv) >= 3:
+        syms = symbolizeelf(sys.argv[2], addrs)
+    else:
+        syms = {a: '' for a in addrs}
+
+    print('Allocations: %d (%d bytes)' % (header['totalallocs'], header['totalbytes']))
+    print('Peak live:   %d bytes' % header['peaklivebytes'])
+    print('Live at end: %d bytes' % header['livebytes'])
+    print('Failed:      %d' % header['failedallocs'])
+    if header['untracked'] != 0:
+        print('Warning: %d allocations were not tracked (table full). Live bytes are too high.' % header['untracked'])
+    print()
+
+    print('%-10s %7s %7s %10s %10s %6s %10s  %s' % ('Call site', 'Allocs', 'Frees', 'Bytes', 'Peak', 'Leaks', 'Leaked', 'Function'))
+    for s in sorted(sites, key=lambda s: (s['livebytes'], s['peakbytes']), reverse=True):
+        print('0x%08X %7d %7d %10d %10d %6d %10d  %s' % (s['callsite'], s['allocs'], s['frees'], s['totalbytes'],
+              s['peakbytes'], s['livecount'], s['livebytes'], syms[s['callsite']]))
@@ -0,0 +1,362 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include "lodepng.h"
+#include "bench.h"
+#include "matrix.h"
+
+
+#define MIN_BENCH_TIME  (0.05) // Seconds of scaling per frame and profile for throughput.
+#define MAX_PSNR        (100.)  // For identical images.
+
+
+struct ProfileStats final
+{
+	double psnr;
+	double ssim;
+	double sharpness;
+	double refSharpness;
+	double seconds;
+	u32 scaledFrames;
+	u32 frames;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+
+bool getStockBenchProfiles(const char *const gbaMatrixPath, std::vector<BenchProfile> &profiles)
+{
+	BenchProfile bilinear{};
+	bilinear.name = "bilinear";
+	bilinear.scaler = 1;
+	bilinear.hardware = false;
+
+	// Loaded from matrixGba.txt so the benchmark always uses what the firmware uses.
+	BenchProfile hardware{};
+	hardware.name = "hardware";
+	hardware.scaler = 2;
+	hardware.hardware = true;
+	if(!loadMatrixProfile(gbaMatrixPath, hardware.params)) return false;
+
+	profiles.push_back(std::move(bilinear));
+	profiles.push_back(std::move(hardware));
+
+	return true;
+}
+
+static void toLuma(const Pixel *const img, const u32 num, float *const luma) noexcept
+{
+	for(u32 i = 0; i < num; i++)
+		luma[i] = 0.299f * img[i].m_r + 0.587f * img[i].m_g + 0.114f * img[i].m_b;
+}
+
+static double calcPsnr(const Pixel *const a, const Pixel *const b, const u32 num) noexcept
+{
+	u64 err = 0;
+	for(u32 i = 0; i < num; i++)
+	{
+		const s32 r = a[i].m_r - b[i].m_r;
+		const s32 g = a[i].m_g - b[i].m_g;
+		const s32 bl = a[i].m_b - b[i].m_b;
+		err += r * r + g * g + bl * bl;
+	}
+	if(err == 0) return MAX_PSNR;
+
+	const double mse = (double)err / (num * 3);
+	return std::min(10. * std::log10(255. * 255. / mse), MAX_PSNR);
+}
+
+// 11x11 gaussian (sigma 1.5) blur without the borders. Output is (w - 10) x (h - 10).
+static void gaussBlur(const float *const in, const u32 w, const u32 h, float *const out)
+{
+	static float kernel[11];
+	if(kernel[5] == 0.f)
+	{
+		float sum = 0.f;
+		for(s32 i = -5; i <= 5; i++) sum += (kernel[i + 5] = std::exp(-(i * i) / (2.f * 1.5f * 1.5f)));
+		for(float &k : kernel) k /= sum;
+	}
+
+	const u32 oW = w - 10, oH = h - 10;
+	std::unique_ptr<float[]> tmp(new float[oW * h]);
+	for(u32 y = 0; y < h; y++)
+	{
+		for(u32 x = 0; x < oW; x++)
+		{
+			float val = 0.f;
+			for(u32 k = 0; k < 11; k++) val += kernel[k] * in[w * y + x + k];
+			tmp[oW * y + x] = val;
+		}
+	}
+	for(u32 y = 0; y < oH; y++)
+	{
+		for(u32 x = 0; x < oW; x++)
+		{
+			float val = 0.f;
+			for(u32 k = 0; k < 11; k++) val += kernel[k] * tmp[oW * (y + k) + x];
+			out[oW * y + x] = val;
+		}
+	}
+}
+
+// SSIM of the luma (Wang et al. 2004).
+static double calcSsim(const float *const a, const float *const b, const u32 w, const u32 h)
+{
+	if(w <= 10 || h <= 10) return 1.;
+
+	const u32 num = w * h;
+	std::unique_ptr<float[]> aa(new float[num]), bb(new float[num]), ab(new float[num]);
+	for(u32 i = 0; i < num; i++)
+	{
+		aa[i] = a[i] * a[i];
+		bb[i] = b[i] * b[i];
+		ab[i] = a[i] * b[i];
+	}
+
+	const u32 oNum = (w - 10) * (h - 10);
+	std::unique_ptr<float[]> muA(new float[oNum]), muB(new float[oNum]);
+	std::unique_ptr<float[]> sAA(new float[oNum]), sBB(new float[oNum]), sAB(new float[oNum]);
+	gaussBlur(a, w, h, muA.get());
+	gaussBlur(b, w, h, muB.get());
+	gaussBlur(aa.get(), w, h, sAA.get());
+	gaussBlur(bb.get(), w, h, sBB.get());
+	gaussBlur(ab.get(), w, h, sAB.get());
+
+	constexpr double c1 = (0.01 * 255) * (0.01 * 255);
+	constexpr double c2 = (0.03 * 255) * (0.03 * 255);
+	double sum = 0.;
+	for(u32 i = 0; i < oNum; i++)
+	{
+		const double mA = muA[i], mB = muB[i];
+		const double varA = sAA[i] - mA * mA;
+		const double varB = sBB[i] - mB * mB;
+		const double cov = sAB[i] - mA * mB;
+		sum += ((2. * mA * mB + c1) * (2. * cov + c2)) / ((mA * mA + mB * mB + c1) * (varA + varB + c2));
+	}
+
+	return sum / oNum;
+}
+
+// Mean Sobel gradient magnitude of the luma.
+static double calcSharpness(const float *const l, const u32 w, const u32 h) noexcept
+{
+	if(w < 3 || h < 3) return 0.;
+
+	double sum = 0.;
+	for(u32 y = 1; y < h - 1; y++)
+	{
+		for(u32 x = 1; x < w - 1; x++)
+		{
+			const float *const p = &l[w * y + x];
+			const s32 s = w; // Signed stride for negative offsets.
+			const float gx = (p[-s + 1] + 2.f * p[1] + p[s + 1]) - (p[-s - 1] + 2.f * p[-1] + p[s - 1]);
+			const float gy = (p[s - 1] + 2.f * p[s] + p[s + 1]) - (p[-s - 1] + 2.f * p[-s] + p[-s + 1]);
+			sum += std::sqrt(gx * gx + gy * gy);
+		}
+	}
+
+	return sum / ((w - 2) * (h - 2));
+}
+
+// Scales the frame repeatedly for at least MIN_BENCH_TIME.
+// The GPU bilinear scaler is not simulated in a way that says anything
+// about its speed so it's scaled once and not timed.
+static void scaleTimed(const BenchProfile &profile, const Pixel *const frame, const ScalerParams &params,
+                       Pixel *const out, ProfileStats &stats)
+{
+	if(!profile.hardware)
+	{
+		resampleImage(Kernel::bilinear, frame, params.oWidth, params.oHight, out, params.width, params.hight);
+		return;
+	}
+
+	std::unique_ptr<Pixel[]> buf(new Pixel[512 * 512]);
+	const u32 inNum = params.oWidth * params.oHight;
+
+	double seconds = 0.;
+	u32 runs = 0;
+	do
+	{
+		for(u32 i = 0; i < inNum; i++) buf[i] = frame[i];
+
+		const auto start = Clock::now();
+		scaleFrame(buf.get(), params);
+		seconds += std::chrono::duration<double>(Clock::now() - start).count();
+		runs++;
+	} while(seconds < MIN_BENCH_TIME);
+
+	for(u32 i = 0; i < (u32)params.width * params.hight; i++) out[i] = buf[i];
+	stats.seconds += seconds;
+	stats.scaledFrames += runs;
+}
+
+// Profile names come from matrix files.
+static std::string jsonEscape(const std::string &str)
+{
+	std::string out;
+	for(const char c : str)
+	{
+		if(c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if((unsigned char)c < 0x20)
+		{
+			char esc[7];
+			snprintf(esc, sizeof(esc), "\\u%04X", (unsigned)(unsigned char)c);
+			out += esc;
+		}
+		else out += c;
+	}
+
+	return out;
+}
+
+static bool writeSummary(const char *const path, const std::vector<BenchProfile> &profiles,
+                         const std::vector<ProfileStats> &stats, const char *const refKernelName, const u32 numFrames)
+{
+	FILE *const f = fopen(path, "w");
+	if(f == nullptr) return false;
+
+	fprintf(f, "{\n"
+	           "\t\"reference\": \"%s\",\n"
+	           "\t\"frames\": %" PRIu32 ",\n"
+	           "\t\"profiles\": [\n", refKernelName, numFrames);
+	for(size_t i = 0; i < profiles.size(); i++)
+	{
+		const ProfileStats &s = stats[i];
+		const double n = (s.frames > 0 ? s.frames : 1);
+		fprintf(f, "\t\t{\n"
+		           "\t\t\t\"name\": \"%s\",\n"
+		           "\t\t\t\"scaler\": %" PRIu8 ",\n"
+		           "\t\t\t\"simulation\": \"%s\",\n"
+		           "\t\t\t\"frames\": %" PRIu32 ",\n"
+		           "\t\t\t\"psnr\": %.4f,\n"
+		           "\t\t\t\"ssim\": %.6f,\n"
+		           "\t\t\t\"sharpness\": %.4f,\n"
+		           "\t\t\t\"refSharpness\": %.4f",
+		        jsonEscape(profiles[i].name).c_str(), profiles[i].scaler, (profiles[i].hardware ? "lgyfb" : "gpu-bilinear"),
+		        s.frames, s.psnr / n, s.ssim / n, s.sharpness / n, s.refSharpness / n);
+		// Only the simulated LgyFb scaler is timed.
+		if(profiles[i].hardware)
+			fprintf(f, ",\n\t\t\t\"framesPerSecond\": %.2f", (s.seconds > 0. ? s.scaledFrames / s.seconds : 0.));
+		fprintf(f, "\n\t\t}%s\n", (i == profiles.size() - 1 ? "" : ","));
+	}
+	fputs("\t]\n}\n", f);
+
+	const bool ok = ferror(f) == 0;
+	fclose(f);
+
+	return ok;
+}
+
+bool runBenchmark(const std::vector<BenchProfile> &profiles, const std::vector<std::string> &frames,
+                  const Kernel refKernel, const char *const summaryPath)
+{
+	std::vector<ProfileStats> stats(profiles.size(), ProfileStats{});
+	std::unique_ptr<Pixel[]> frame(new Pixel[512 * 512]);
+	std::unique_ptr<Pixel[]> out(new Pixel[512 * 512]);
+	std::unique_ptr<Pixel[]> ref(new Pixel[512 * 512]);
+	std::unique_ptr<float[]> outLuma(new float[512 * 512]);
+	std::unique_ptr<float[]> refLuma(new float[512 * 512]);
+	u32 numFrames = 0;
+	for(const std::string &path : frames)
+	{
+		unsigned char *img;
+		u32 width, hight;
+		u32 lpngErr;
+		if((lpngErr = lodepng_decode32_file(&img, &width, &hight, path.c_str())))
+		{
+			fprintf(stderr, "lodepng error: %s: %s\n", path.c_str(), lodepng_error_text(lpngErr));
+			return false;
+		}
+		if(width > 512 || hight > 512)
+		{
+			fprintf(stderr, "Warning: %s: Skipping frame. Too big.\n", path.c_str());
+			free(img);
+			continue;
+		}
+		memcpy(frame.get(), img, sizeof(Pixel) * width * hight);
+		free(img);
+		numFrames++;
+
+		for(size_t p = 0; p < profiles.size(); p++)
+		{
+			const BenchProfile &profile = profiles[p];
+			ScalerParams params = profile.params;
+			params.oWidth = width;
+			params.oHight = hight;
+			if(profile.hardware)
+			{
+				params.width = width * profile.params.hLen / __builtin_popcount(profile.params.hPatt);
+				params.hight = hight * profile.params.vLen / __builtin_popcount(profile.params.vPatt);
+			}
+			else
+			{
+				params.width = width * 3 / 2;
+				params.hight = hight * 3 / 2;
+			}
+			if(params.width > 512 || params.hight > 512)
+			{
+				fprintf(stderr, "Warning: %s: Output too big for profile %s.\n", path.c_str(), profile.name.c_str());
+				continue;
+			}
+
+			ProfileStats &s = stats[p];
+			scaleTimed(profile, frame.get(), params, out.get(), s);
+
+			const u32 outNum = params.width * params.hight;
+			resampleImage(refKernel, frame.get(), width, hight, ref.get(), params.width, params.hight);
+			toLuma(out.get(), outNum, outLuma.get());
+			toLuma(ref.get(), outNum, refLuma.get());
+
+			s.psnr += calcPsnr(out.get(), ref.get(), outNum);
+			s.ssim += calcSsim(outLuma.get(), refLuma.get(), params.width, params.hight);
+			s.sharpness += calcSharpness(outLuma.get(), params.width, params.hight);
+			s.refSharpness += calcSharpness(refLuma.get(), params.width, params.hight);
+			s.frames++;
+		}
+	}
+
+	printf("%-16s %6s %8s %8s %10s %10s\n", "Profile", "Scaler", "PSNR", "SSIM", "Sharpness", "Frames/s");
+	for(size_t p = 0; p < profiles.size(); p++)
+	{
+		const ProfileStats &s = stats[p];
+		const double n = (s.frames > 0 ? s.frames : 1);
+		printf("%-16s %6" PRIu8 " %8.3f %8.5f %10.3f ", profiles[p].name.c_str(), profiles[p].scaler,
+		       s.psnr / n, s.ssim / n, (s.refSharpness > 0. ? s.sharpness / s.refSharpness : 0.));
+		if(profiles[p].hardware) printf("%10.1f\n", (s.seconds > 0. ? s.scaledFrames / s.seconds : 0.));
+		else                     printf("%10s\n", "-");
+	}
+	puts("Sharpness is relative to the reference. Frames/s is the simulated LgyFb scaler on this PC.");
+
+	if(!writeSummary(summaryPath, profiles, stats, kernel2Str(refKernel), numFrames))
+	{
+		fprintf(stderr, "Error: Failed to write '%s'.\n", summaryPath);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+#include "kernels.h"
+#include "scaler.h"
+
+
+struct BenchProfile final
+{
+	std::string name;
+	u8 scaler;           // Value of the scaler config option.
+	bool hardware;       // false = GPU bilinear (simulated).
+	ScalerParams params; // Only for hardware profiles. Sizes are set per frame.
+};
+
+
+// Appends the profiles that are always benchmarked (scaler 1 and 2).
+// Scaler 2 is loaded from gbaMatrixPath (matrixGba.txt).
+bool getStockBenchProfiles(const char *const gbaMatrixPath, std::vector<BenchProfile> &profiles);
+
+// Scales every frame with every profile and compares the results against
+// refKernel. Prints a table and writes a JSON summary to summaryPath.
+bool runBenchmark(const std::vector<BenchProfile> &profiles, const std::vector<std::string> &frames,
+                  const Kernel refKernel, const char *const summaryPath);
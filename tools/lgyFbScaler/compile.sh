@@ -1,4 +1,4 @@
 #!/bin/bash
 
 rm ./lgyFbScaler
-g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler
\ No newline at end of file
+g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./scaler.cpp ./kernels.cpp ./optimizer.cpp ./bench.cpp ./matrix.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler
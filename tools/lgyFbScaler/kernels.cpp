@@ -0,0 +1,170 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "kernels.h"
+
+
+
+static const struct
+{
+	const char *name;
+	Kernel kernel;
+} g_kernelLut[6] =
+{
+	{"bilinear",       Kernel::bilinear},
+	{"sharp-bilinear", Kernel::sharpBilinear},
+	{"bicubic",        Kernel::bicubic},
+	{"lanczos2",       Kernel::lanczos2},
+	{"lanczos3",       Kernel::lanczos3},
+	{"ref",            Kernel::ref}
+};
+
+
+bool str2Kernel(const char *const str, Kernel &kernel)
+{
+	for(const auto &entry : g_kernelLut)
+	{
+		if(strcmp(str, entry.name) == 0)
+		{
+			kernel = entry.kernel;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* kernel2Str(const Kernel kernel)
+{
+	for(const auto &entry : g_kernelLut)
+	{
+		if(entry.kernel == kernel) return entry.name;
+	}
+
+	return "unknown";
+}
+
+static double sinc(double x) noexcept
+{
+	if(x == 0.) return 1.;
+	x *= M_PI;
+	return std::sin(x) / x;
+}
+
+s32 kernelWeights(const Kernel kernel, const double center, const double scale, double w[8]) noexcept
+{
+	const s32 base = (s32)std::floor(center);
+	const s32 first = base - 3;
+	for(u8 i = 0; i < 8; i++)
+	{
+		const double x = std::fabs((first + i) - center);
+		double weight = 0.;
+		switch(kernel)
+		{
+			case Kernel::ref: // Bilinear is a good enough starting point.
+			case Kernel::bilinear:
+				weight = (x < 1. ? 1. - x : 0.);
+				break;
+			case Kernel::bicubic: // Catmull-Rom.
+				if(x < 1.)      weight = 1.5 * x * x * x - 2.5 * x * x + 1.;
+				else if(x < 2.) weight = -0.5 * x * x * x + 2.5 * x * x - 4. * x + 2.;
+				break;
+			case Kernel::lanczos2:
+				weight = (x < 2. ? sinc(x) * sinc(x / 2.) : 0.);
+				break;
+			case Kernel::lanczos3:
+				weight = (x < 3. ? sinc(x) * sinc(x / 3.) : 0.);
+				break;
+			case Kernel::sharpBilinear:
+				break;
+		}
+		w[i] = weight;
+	}
+
+	if(kernel == Kernel::sharpBilinear)
+	{
+		// Same as the common sharp-bilinear shaders with prescale = scale.
+		const double range = 0.5 - 0.5 / scale;
+		const double dist = (center - base) - 0.5;
+		const double f = (dist - std::clamp(dist, -range, range)) * scale + 0.5;
+		w[3] = 1. - f;
+		w[4] = f;
+	}
+
+	double sum = 0.;
+	for(u8 i = 0; i < 8; i++) sum += w[i];
+	for(u8 i = 0; i < 8; i++) w[i] /= sum;
+
+	return first;
+}
+
+double outCenter(const u32 outPos, const u32 inLen, const u32 outLen) noexcept
+{
+	return (outPos + 0.5) * inLen / outLen - 0.5;
+}
+
+// Resamples one channel of a line. stride is in elements.
+static void resample1D(const Kernel kernel, const float *const in, const u32 inLen, const u32 inStride,
+                       float *const out, const u32 outLen, const u32 outStride)
+{
+	const double scale = (double)outLen / inLen;
+	for(u32 j = 0; j < outLen; j++)
+	{
+		double w[8];
+		const s32 first = kernelWeights(kernel, outCenter(j, inLen, outLen), scale, w);
+
+		double val = 0.;
+		for(u8 i = 0; i < 8; i++)
+		{
+			const s32 pos = std::clamp<s32>(first + i, 0, inLen - 1);
+			val += w[i] * in[pos * inStride];
+		}
+		out[j * outStride] = (float)val;
+	}
+}
+
+void resampleImage(const Kernel kernel, const Pixel *const in, const u32 inWidth, const u32 inHight,
+                   Pixel *const out, const u32 outWidth, const u32 outHight)
+{
+	std::vector<float> src(inWidth * inHight);
+	std::vector<float> tmp(outWidth * inHight);
+	std::vector<float> dst(outWidth * outHight);
+	for(u8 c = 0; c < 3; c++)
+	{
+		for(u32 i = 0; i < inWidth * inHight; i++)
+			src[i] = (c == 0 ? in[i].m_r : (c == 1 ? in[i].m_g : in[i].m_b));
+
+		for(u32 h = 0; h < inHight; h++)
+			resample1D(kernel, &src[inWidth * h], inWidth, 1, &tmp[outWidth * h], outWidth, 1);
+		for(u32 w = 0; w < outWidth; w++)
+			resample1D(kernel, &tmp[w], inHight, outWidth, &dst[w], outHight, outWidth);
+
+		for(u32 i = 0; i < outWidth * outHight; i++)
+		{
+			const u8 val = (u8)std::clamp(std::lround(dst[i]), 0l, 255l);
+			if(c == 0)      out[i].m_r = val;
+			else if(c == 1) out[i].m_g = val;
+			else            out[i].m_b = val;
+		}
+	}
+
+	for(u32 i = 0; i < outWidth * outHight; i++) out[i].m_a = 0xFFu;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scaler.h"
+
+
+enum class Kernel : u8
+{
+	bilinear,
+	sharpBilinear,
+	bicubic,
+	lanczos2,
+	lanczos3,
+	ref            // High-res reference images.
+};
+
+
+
+// Returns false for unknown kernel names.
+bool str2Kernel(const char *const str, Kernel &kernel);
+const char* kernel2Str(const Kernel kernel);
+
+// Calculates the normalized weights for the input pixels first to first + 7
+// for an output pixel centered at center (in input pixel coordinates).
+// Returns first.
+s32 kernelWeights(const Kernel kernel, const double center, const double scale, double w[8]) noexcept;
+
+// Center of output pixel outPos in input pixel coordinates.
+double outCenter(const u32 outPos, const u32 inLen, const u32 outLen) noexcept;
+
+// Separable resample of a whole image with the kernel in floating point.
+void resampleImage(const Kernel kernel, const Pixel *const in, const u32 inWidth, const u32 inHight,
+                   Pixel *const out, const u32 outWidth, const u32 outHight);
@@ -15,245 +15,328 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cctype>
 #include <cstdio>
 #include <cinttypes>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <memory>
+#include <string>
 #include "lodepng.h"
+#include "scaler.h"
+#include "kernels.h"
+#include "optimizer.h"
+#include "bench.h"
+#include "matrix.h"
 
 
 #define NDEBUG  (1)
 
 
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-
-typedef int8_t  s8;
-typedef int16_t s16;
-typedef int32_t s32;
-typedef int64_t s64;
-
-
-typedef struct
+static void coeff2Str(const s16 val, char str[8])
 {
-	u16 oWidth;
-	u16 oHight;
-	u16 width;
-	u16 hight;
-	s16 vMatrix[8 * 6];
-	s16 hMatrix[8 * 6];
-	u8  vPatt;
-	u8  hPatt;
-	u8  vLen;
-	u8  hLen;
-} ScalerParams;
-
-struct Pixel final
+	if(val == 0) strcpy(str, "0");
+	else         snprintf(str, 8, "%s0x%X", (val < 0 ? "-" : ""), (u32)(val < 0 ? -val : val));
+}
+
+static bool writeMatrix(const char *const file, const ScalerParams &params)
 {
-	u8 m_r, m_g, m_b, m_a;
+	FILE *f = fopen(file, "w");
+	if(f == nullptr) return false;
 
+	for(u8 dir = 0; dir < 2; dir++)
+	{
+		const u8 patt = (dir == 0 ? params.hPatt : params.vPatt);
+		const u8 len = (dir == 0 ? params.hLen : params.vLen);
+		const s16 *const matrix = (dir == 0 ? params.hMatrix : params.vMatrix);
 
-	// Constructors
-	Pixel(void) noexcept {}
-	Pixel(u8 r, u8 g, u8 b, u8 a = 0xFFu) noexcept : m_r(r), m_g(g), m_b(b), m_a(a) {}
-	Pixel(const Pixel&) noexcept = delete; // Copy
-	Pixel(Pixel&&) noexcept = delete;      // Move
+		char pattStr[9];
+		for(u8 i = 0; i < 8; i++) pattStr[i] = (patt & 1u<<(7 - i) ? '1' : '0');
+		pattStr[8] = '\0';
+		fprintf(f, "%s%s, %" PRIu8 ",\n", (dir == 0 ? "" : "\n"), pattStr, len);
 
-	// Destructors
-	//~Pixel(void) noexcept = default;
+		for(u8 i = 0; i < 48; i++)
+		{
+			char valStr[8];
+			coeff2Str(matrix[i], valStr);
 
-	// Operators
-	Pixel& operator =(const Pixel&) noexcept = default; // Copy
-	Pixel& operator =(Pixel&&) noexcept = default;      // Move
+			const bool last = dir == 1 && i == 47;
+			fprintf(f, "%7s%s", valStr, (last ? "" : (i % 8 == 7 ? ",\n" : ", ")));
+		}
+	}
 
-	// Functions
-};
+	const bool ok = ferror(f) == 0;
+	fclose(f);
 
-class Scaler final
-{
-	const Pixel *m_buf;
-	const s16 *const m_matrix;
-	s16 m_pos;
-	const u16 m_lineLen;
-	const u8 m_patt;
-	const u8 m_pattLen;
-	u8 m_pattPos;
+	return ok;
+}
 
+static int optimizeMain(int argc, char const *argv[])
+{
+	if(argc < 6)
+	{
+		fputs("Usage: lgyFbScaler optimize <pattern> <length> <target> <out.txt> [image.png...]\n"
+		      "Targets: bilinear, sharp-bilinear, bicubic, lanczos2, lanczos3 or\n"
+		      "ref (images are high-res references).\n", stderr);
+		return 1;
+	}
 
-	// Constructors
-	Scaler(void) noexcept = delete;
-	Scaler(const Scaler&) noexcept = delete; // Copy
-	Scaler(Scaler&&) noexcept = delete;      // Move
+	static ScalerParams params{};
+	params.hPatt = strtoul(argv[2], nullptr, 2) & 0xFFu;
+	params.hLen = strtoul(argv[3], nullptr, 10) & 0xFFu;
+	if(!optimizeMatrix(params.hPatt, params.hLen, argv[4], &argv[6], argc - 6, params.hMatrix))
+		return 2;
 
-	// Destructors
-	//~Scaler(void) noexcept = default;
+	// Same matrix for both directions like the stock matrices.
+	params.vPatt = params.hPatt;
+	params.vLen = params.hLen;
+	memcpy(params.vMatrix, params.hMatrix, sizeof(params.vMatrix));
+	if(!writeMatrix(argv[5], params))
+	{
+		fputs("Failed to write matrix file.", stderr);
+		return 3;
+	}
 
-	// Operators
-	Scaler& operator =(const Scaler&) noexcept = delete; // Copy
-	Scaler& operator =(Scaler&&) noexcept = delete;      // Move
+	return 0;
+}
 
-	const Pixel& operator [](u8 idx) const noexcept
+// Checks if the firmware can use the matrix as is.
+// GBA mode expects 240x160 --> 360x240 (see patchGbaGpuCmdList()).
+static bool validateForFirmware(const char *const name, ScalerParams &params)
+{
+	bool ok = true;
+	for(u8 dir = 0; dir < 2; dir++)
 	{
-		//idx = (idx > 5 ? 5 : idx);
+		const char *const dirStr = (dir == 0 ? "horizontal" : "vertical");
+		u8 &patt = (dir == 0 ? params.hPatt : params.vPatt);
+		const u8 len = (dir == 0 ? params.hLen : params.vLen);
+		s16 *const matrix = (dir == 0 ? params.hMatrix : params.vMatrix);
 
-		idx = 5 - idx;
-		u32 bufPos;
-		if(m_pos - idx <= 0)               bufPos = 0;             // Output first pixel for lower out of bounds.
-		else if(m_pos - idx >= m_lineLen)  bufPos = m_lineLen - 1; // Output last pixel for upper out of bounds.
-		else                               bufPos = m_pos - idx;   // Normal pixel window offset.
+		if(patt & ~((1u<<len) - 1))
+		{
+			fprintf(stderr, "Warning: %s: Ignoring %s pattern bits beyond the length.\n", name, dirStr);
+			patt &= (1u<<len) - 1;
+		}
 
-		return m_buf[bufPos];
-	}
+		// The scaler loses sync with the GBA input otherwise.
+		if((patt & 1u) == 0 || (patt & 1u<<(len - 1)) != 0)
+		{
+			fprintf(stderr, "Error: %s: First %s pattern bit must be 1 and the last 0.\n", name, dirStr);
+			ok = false;
+		}
 
-	// Functions
+		if((u32)len * 2 != (u32)__builtin_popcount(patt) * 3)
+		{
+			fprintf(stderr, "Error: %s: %s scale must be x1.5.\n", name, dirStr);
+			ok = false;
+		}
 
+		for(u8 x = 0; x < 8; x++)
+		{
+			s32 sum = 0;
+			for(u8 y = 0; y < 6; y++)
+			{
+				if(x >= len) matrix[y * 8 + x] = 0; // Unused columns.
+				sum += matrix[y * 8 + x];
+			}
 
-public:
-	// Constructors
-	Scaler(const Pixel *buf, u16 lineLen, const s16 *matrix, u8 patt, u8 pattLen) noexcept
-	: m_buf(buf), m_matrix(matrix), m_pos(0), m_lineLen(lineLen), m_patt(patt), m_pattLen(pattLen), m_pattPos(0)
-	{
+			if(x < len && sum != 0x4000)
+			{
+				fprintf(stderr, "Warning: %s: %s column %" PRIu8 " has a gain of %f.\n",
+				        name, dirStr, x, (float)sum / 0x4000);
+			}
+		}
 	}
 
-	// Destructors
-
-	// Operators
+	return ok;
+}
 
-	// Functions
-	Pixel calcPixel(void) const noexcept
+static void writeProfileMatrix(FILE *const f, const s16 *const matrix, const bool last)
+{
+	fputs("\t\t{\n", f);
+	for(u8 y = 0; y < 6; y++)
 	{
-		s32 r = 0, g = 0, b = 0;
-		const s16 *matrix = &m_matrix[m_pattPos];
-		for(u8 i = 0; i < 6; i++)
+		fputs("\t\t\t{", f);
+		for(u8 x = 0; x < 8; x++)
 		{
-			const Pixel &pixel = (*this)[i];
-			const s16 mult = matrix[i * 8];
-
-			r += pixel.m_r * mult;
-			g += pixel.m_g * mult;
-			b += pixel.m_b * mult;
+			char valStr[8];
+			coeff2Str(matrix[y * 8 + x], valStr);
+			fprintf(f, "%7s%s", valStr, (x == 7 ? "" : ","));
 		}
+		fprintf(f, "}%s\n", (y == 5 ? "" : ","));
+	}
+	fprintf(f, "\t\t}%s\n", (last ? "" : ","));
+}
 
-		// Clamp the result.
-		r = (r > 0x3FC000 ? 0x3FC000 : r);
-		r = (r < 0 ? 0 : r);
-		g = (g > 0x3FC000 ? 0x3FC000 : g);
-		g = (g < 0 ? 0 : g);
-		b = (b > 0x3FC000 ? 0x3FC000 : b);
-		b = (b < 0 ? 0 : b);
-
-		return Pixel(r / 0x4000, g / 0x4000, b / 0x4000);
+static int exportMain(int argc, char const *argv[])
+{
+	if(argc < 4)
+	{
+		fputs("Usage: lgyFbScaler export <scaler_profiles.h> <matrix.txt>...\n", stderr);
+		return 1;
 	}
 
-	void next(void) noexcept
+	std::vector<MatrixProfile> profiles;
+	bool ok = true;
+	for(int i = 3; i < argc; i++)
 	{
-		if(m_patt & 1u<<m_pattPos++)
+		std::vector<MatrixProfile> fileProfiles;
+		if(!loadMatrixFile(argv[i], fileProfiles))
+		{
+			ok = false;
+			continue;
+		}
+
+		for(MatrixProfile &profile : fileProfiles)
 		{
-			if(m_pos == 0) m_pos = 3; // Hardware loads 3 more pixels after the first.
-			else           m_pos++;
+			for(char &c : profile.name)
+			{
+				if(!isalnum((unsigned char)c) && c != '-') c = '_';
+			}
+
+			for(const MatrixProfile &other : profiles)
+			{
+				if(other.name == profile.name)
+				{
+					fprintf(stderr, "Error: Duplicate profile name '%s'.\n", profile.name.c_str());
+					ok = false;
+				}
+			}
+
+			ok &= validateForFirmware(profile.name.c_str(), profile.params);
+			profiles.push_back(std::move(profile));
 		}
+	}
+	if(!ok) return 2;
+	const u32 numProfiles = profiles.size();
 
-		if(m_pattPos == m_pattLen) m_pattPos = 0;
+	FILE *const f = fopen(argv[2], "w");
+	if(f == nullptr)
+	{
+		fprintf(stderr, "Error: Failed to open '%s'.\n", argv[2]);
+		return 3;
 	}
 
-	void nextLine(void) noexcept
+	fprintf(f, "#pragma once\n\n"
+	           "// Generated by \"lgyFbScaler export\". Do not edit.\n"
+	           "// Profile n is selected with scaler=n+3 in the config.\n\n"
+	           "#include \"types.h\"\n\n\n"
+	           "#define NUM_SCALER_PROFILES  (%" PRIu32 "u)\n\n"
+	           "typedef struct\n"
+	           "{\n"
+	           "\tconst char *name;\n"
+	           "\tu8 hLen;            // Pattern length - 1.\n"
+	           "\tu8 hPatt;\n"
+	           "\tu8 vLen;            // Pattern length - 1.\n"
+	           "\tu8 vPatt;\n"
+	           "\ts16 hMatrix[6][8];  // Bits 0-3 are not used.\n"
+	           "\ts16 vMatrix[6][8];  // Bits 0-3 are not used.\n"
+	           "} ScalerProfile;\n\n"
+	           "static const ScalerProfile g_scalerProfiles[NUM_SCALER_PROFILES] =\n"
+	           "{\n", numProfiles);
+
+	for(u32 i = 0; i < numProfiles; i++)
 	{
-		m_buf += m_lineLen;
-		m_pos = 0;
+		const ScalerParams &params = profiles[i].params;
+		fprintf(f, "\t{\n"
+		           "\t\t\"%s\",\n"
+		           "\t\t%" PRIu8 ", 0x%02" PRIX8 ", %" PRIu8 ", 0x%02" PRIX8 ",\n",
+		        profiles[i].name.c_str(), (u8)(params.hLen - 1), params.hPatt, (u8)(params.vLen - 1), params.vPatt);
+		writeProfileMatrix(f, params.hMatrix, false);
+		writeProfileMatrix(f, params.vMatrix, true);
+		fprintf(f, "\t}%s\n", (i == numProfiles - 1 ? "" : ","));
 	}
+	fputs("};\n", f);
 
-	void resetLine(void) noexcept
+	ok = ferror(f) == 0;
+	fclose(f);
+	if(!ok)
 	{
-		m_pos = 0;
-		m_pattPos = 0;
+		fprintf(stderr, "Error: Failed to write '%s'.\n", argv[2]);
+		return 3;
 	}
-};
 
+	return 0;
+}
 
-static void scaleFrame(Pixel *buf, const ScalerParams &params)
+static int benchMain(int argc, char const *argv[])
 {
-	std::unique_ptr<Pixel[]> tmpBuf(new(std::nothrow) Pixel[512 * 512]);
-	const u16 oHight = params.oHight;
-	const u16 width = params.width;
+	if(argc < 4)
+	{
+		fputs("Usage: lgyFbScaler bench <summary.json> [-r <kernel>] [-g <matrixGba.txt>] [-m <matrix.txt>]... <frame.png|dir>...\n"
+		      "Reference kernel (default lanczos3): bilinear, sharp-bilinear, bicubic, lanczos2, lanczos3.\n"
+		      "The hardware profile (scaler=2) is loaded from -g (default ./matrixGba.txt).\n"
+		      "Custom matrices are numbered scaler=3 and up in the given order.\n", stderr);
+		return 1;
+	}
 
+	const char *gbaMatrixPath = "matrixGba.txt";
+	std::vector<const char*> matrixPaths;
+	std::vector<std::string> frames;
+	Kernel refKernel = Kernel::lanczos3;
+	for(int i = 3; i < argc; i++)
 	{
-		Scaler scaler(buf, params.oWidth, params.hMatrix, params.hPatt, params.hLen);
-		for(u16 h = 0; h < oHight; h++)
+		const char *const arg = argv[i];
+		if(strcmp(arg, "-r") == 0 && i + 1 < argc)
 		{
-			for(u16 w = 0; w < width; w++)
+			if(!str2Kernel(argv[++i], refKernel) || refKernel == Kernel::ref)
 			{
-				tmpBuf[width * h + w] = scaler.calcPixel();
-				scaler.next();
+				fprintf(stderr, "Error: Invalid reference kernel '%s'.\n", argv[i]);
+				return 1;
 			}
-
-			scaler.nextLine();
 		}
-	}
-
-	{
-		std::unique_ptr<Pixel[]> tmpLine(new(std::nothrow) Pixel[512]);
-		const u16 hight = params.hight;
-		Scaler scaler(tmpLine.get(), oHight, params.vMatrix, params.vPatt, params.vLen);
-		for(u16 w = 0; w < width; w++)
+		else if(strcmp(arg, "-g") == 0 && i + 1 < argc) gbaMatrixPath = argv[++i];
+		else if(strcmp(arg, "-m") == 0 && i + 1 < argc) matrixPaths.push_back(argv[++i]);
+		else if(std::filesystem::is_directory(arg))
 		{
-			for(u16 h = 0; h < oHight; h++)
-				tmpLine[h] = tmpBuf[width * h + w];
-
-			for(u16 h = 0; h < hight; h++)
+			std::vector<std::string> dirFrames;
+			for(const auto &entry : std::filesystem::directory_iterator(arg))
 			{
-				buf[width * h + w] = scaler.calcPixel();
-				scaler.next();
+				if(entry.is_regular_file() && entry.path().extension() == ".png")
+					dirFrames.push_back(entry.path().string());
 			}
-			scaler.resetLine();
+			std::sort(dirFrames.begin(), dirFrames.end());
+			frames.insert(frames.end(), dirFrames.begin(), dirFrames.end());
 		}
+		else frames.push_back(arg);
 	}
-}
-
-// TODO: More validation.
-static bool parseMatrix(const char *const file, ScalerParams &params)
-{
-	char buf[1024] = {};
-	FILE *f = fopen(file, "r");
-	fread(buf, 1023, 1, f);
-	fclose(f);
-
-	// Parse horizontal params.
-	const char *token;
-	if((token = strtok(buf, "\t ,\n\r")) == nullptr) return false;
-	params.hPatt = strtoul(token, nullptr, 2) & 0xFFu;
-
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.hLen = strtoul(token, nullptr, 10) & 0xFFu;
-	if(params.hLen > 8 || params.hLen < 1) return false;
-
-	for(u8 i = 0; i < 48; i++)
+	if(frames.empty())
 	{
-		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
-		params.hMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
+		fputs("Error: No frames.\n", stderr);
+		return 1;
 	}
 
-	// Parse vertical params.
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.vPatt = strtoul(token, nullptr, 2) & 0xFFu;
-
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.vLen = strtoul(token, nullptr, 10) & 0xFFu;
-	if(params.vLen > 8 || params.vLen < 1) return false;
-
-	for(u8 i = 0; i < 48; i++)
+	std::vector<BenchProfile> profiles;
+	if(!getStockBenchProfiles(gbaMatrixPath, profiles)) return 2;
+	for(const char *const path : matrixPaths)
 	{
-		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
-		params.vMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
+		std::vector<MatrixProfile> fileProfiles;
+		if(!loadMatrixFile(path, fileProfiles)) return 2;
+
+		for(MatrixProfile &matrix : fileProfiles)
+		{
+			BenchProfile profile{};
+			profile.name = std::move(matrix.name);
+			profile.scaler = profiles.size() + 1;
+			profile.hardware = true;
+			profile.params = matrix.params;
+			profiles.push_back(std::move(profile));
+		}
 	}
 
-	return true;
+	return (runBenchmark(profiles, frames, refKernel, argv[2]) ? 0 : 3);
 }
 
-// Compile with "g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
-int main(int argc, char const *argv[])
+static int scaleMain(int argc, char const *argv[])
 {
+	if(argc < 4)
+	{
+		fputs("Usage: lgyFbScaler <in.png> <matrix.txt[:profile]> <out.png>\n", stderr);
+		return 5;
+	}
+
 	unsigned char *inBuf;
 	u32 oWidth, oHight;
 	u32 lpngErr;
@@ -275,11 +358,7 @@ int main(int argc, char const *argv[])
 	free(inBuf);
 
 	static ScalerParams params = {(u16)oWidth, (u16)oHight};
-	if(!parseMatrix(argv[2], params))
-	{
-		fputs("Failed to parse matrix file.", stderr);
-		return 3;
-	}
+	if(!loadMatrixProfile(argv[2], params)) return 3;
 
 	const float scaleX = (float)params.hLen / __builtin_popcount(params.hPatt);
 	const float scaleY = (float)params.vLen / __builtin_popcount(params.vPatt);
@@ -298,3 +377,13 @@ int main(int argc, char const *argv[])
 
 	return 0;
 }
+
+// Compile with "g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./scaler.cpp ./kernels.cpp ./optimizer.cpp ./bench.cpp ./matrix.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
+int main(int argc, char const *argv[])
+{
+	if(argc > 1 && strcmp(argv[1], "optimize") == 0) return optimizeMain(argc, argv);
+	if(argc > 1 && strcmp(argv[1], "export") == 0)   return exportMain(argc, argv);
+	if(argc > 1 && strcmp(argv[1], "bench") == 0)    return benchMain(argc, argv);
+
+	return scaleMain(argc, argv);
+}
@@ -0,0 +1,372 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "matrix.h"
+
+
+#define VALUES_PER_DIR      (2u + 48u) // Pattern, length and 48 coefficients.
+#define VALUES_PER_PROFILE  (VALUES_PER_DIR * 2)
+#define CACHE_MAGIC         (0x4D59474Cu) // "LGYM"
+#define CACHE_VERSION       (1u)
+
+
+struct Token final
+{
+	std::string str;
+	u32 line;
+	u32 col;
+	bool isSection; // "[name]".
+};
+
+// Same layout in memory and in the cache file.
+struct CachedProfile final
+{
+	char name[64];
+	u8 hPatt;
+	u8 hLen;
+	u8 vPatt;
+	u8 vLen;
+	s16 hMatrix[8 * 6];
+	s16 vMatrix[8 * 6];
+};
+
+struct CacheHeader final
+{
+	u32 magic;
+	u32 version;
+	u64 srcSize;
+	s64 srcTime;
+	u32 numProfiles;
+	u32 reserved;
+};
+
+
+static void printError(const char *const path, const Token &tok, const char *const msg)
+{
+	fprintf(stderr, "%s:%" PRIu32 ":%" PRIu32 ": error: %s\n", path, tok.line, tok.col, msg);
+}
+
+static void tokenize(const std::string &text, std::vector<Token> &tokens)
+{
+	u32 line = 1, col = 1;
+	for(size_t i = 0; i < text.size();)
+	{
+		const char c = text[i];
+		if(c == '\n')
+		{
+			line++;
+			col = 1;
+			i++;
+			continue;
+		}
+		if(c == ' ' || c == '\t' || c == '\r' || c == ',')
+		{
+			col++;
+			i++;
+			continue;
+		}
+		if(c == '#' || (c == '/' && i + 1 < text.size() && text[i + 1] == '/'))
+		{
+			while(i < text.size() && text[i] != '\n') i++;
+			continue;
+		}
+
+		Token tok;
+		tok.line = line;
+		tok.col = col;
+		tok.isSection = (c == '[');
+		const size_t start = i;
+		if(tok.isSection)
+		{
+			while(i < text.size() && text[i] != ']' && text[i] != '\n') i++;
+			if(i < text.size() && text[i] == ']') i++;
+		}
+		else
+		{
+			while(i < text.size() && strchr(" \t\r\n,#[", text[i]) == nullptr) i++;
+		}
+		tok.str.assign(text, start, i - start);
+		col += i - start;
+		tokens.push_back(std::move(tok));
+	}
+}
+
+static bool parseValue(const char *const path, const Token &tok, const u32 field, CachedProfile &profile,
+                       const Token *&firstUnused, u32 &numUnused)
+{
+	const bool vertical = field >= VALUES_PER_DIR;
+	const u32 idx = field % VALUES_PER_DIR;
+	const char *const str = tok.str.c_str();
+	char *end;
+	errno = 0;
+
+	if(idx == 0) // Pattern.
+	{
+		if(tok.str.size() > 8 || strspn(str, "01") != tok.str.size())
+		{
+			printError(path, tok, "Pattern must be up to 8 binary digits.");
+			return false;
+		}
+
+		const u8 patt = strtoul(str, nullptr, 2);
+		if(vertical) profile.vPatt = patt;
+		else         profile.hPatt = patt;
+	}
+	else if(idx == 1) // Length.
+	{
+		const unsigned long len = strtoul(str, &end, 10);
+		if(*end != '\0' || len < 1 || len > 8)
+		{
+			printError(path, tok, "Pattern length must be 1-8.");
+			return false;
+		}
+
+		const u8 patt = (vertical ? profile.vPatt : profile.hPatt);
+		if((patt & ((1u<<len) - 1)) == 0)
+		{
+			printError(path, tok, "Pattern has no bits set within the length.");
+			return false;
+		}
+
+		if(vertical) profile.vLen = len;
+		else         profile.hLen = len;
+	}
+	else // Coefficient.
+	{
+		const long val = strtol(str, &end, 0);
+		if(*end != '\0' || errno == ERANGE || val < -0x8000 || val > 0x7FFF)
+		{
+			printError(path, tok, "Coefficient must be an integer in the range -0x8000 to 0x7FFF.");
+			return false;
+		}
+		if(val & 15)
+		{
+			if(numUnused++ == 0) firstUnused = &tok;
+		}
+
+		s16 *const matrix = (vertical ? profile.vMatrix : profile.hMatrix);
+		matrix[idx - 2] = (s16)val & ~15u; // Bits 0-3 are not used.
+	}
+
+	return true;
+}
+
+static bool parseMatrixText(const char *const path, const std::string &text, const std::string &defaultName,
+                            std::vector<CachedProfile> &out)
+{
+	std::vector<Token> tokens;
+	tokenize(text, tokens);
+
+	std::vector<CachedProfile> profiles;
+	const Token *firstUnused = nullptr;
+	u32 numUnused = 0;
+	u32 field = VALUES_PER_PROFILE; // No open profile.
+	for(size_t t = 0; t <= tokens.size(); t++)
+	{
+		const bool isEnd = t == tokens.size();
+		const Token endTok = {"", (tokens.empty() ? 1 : tokens.back().line), (tokens.empty() ? 1 : tokens.back().col), false};
+		const Token &tok = (isEnd ? endTok : tokens[t]);
+
+		if(isEnd || tok.isSection)
+		{
+			if(field != VALUES_PER_PROFILE)
+			{
+				char msg[128];
+				snprintf(msg, sizeof(msg), "Profile '%s' is incomplete. Expected %u values but got %" PRIu32 ".",
+				         profiles.back().name, VALUES_PER_PROFILE, field);
+				printError(path, tok, msg);
+				return false;
+			}
+			if(isEnd) break;
+
+			if(tok.str.size() < 3 || tok.str.back() != ']' || tok.str.size() - 2 >= sizeof(CachedProfile::name))
+			{
+				printError(path, tok, "Invalid profile name.");
+				return false;
+			}
+
+			CachedProfile profile{};
+			tok.str.copy(profile.name, tok.str.size() - 2, 1);
+			for(const CachedProfile &p : profiles)
+			{
+				if(strcmp(p.name, profile.name) == 0)
+				{
+					printError(path, tok, "Duplicate profile name.");
+					return false;
+				}
+			}
+			profiles.push_back(profile);
+			field = 0;
+			continue;
+		}
+
+		if(field == VALUES_PER_PROFILE)
+		{
+			// Values without a [name] line are only allowed for the first profile.
+			if(!profiles.empty())
+			{
+				printError(path, tok, "Too many values. Missing [name] line?");
+				return false;
+			}
+
+			CachedProfile profile{};
+			strncpy(profile.name, defaultName.c_str(), sizeof(profile.name) - 1);
+			profiles.push_back(profile);
+			field = 0;
+		}
+
+		if(!parseValue(path, tok, field, profiles.back(), firstUnused, numUnused)) return false;
+		field++;
+	}
+
+	if(profiles.empty())
+	{
+		fprintf(stderr, "%s: error: No matrices found.\n", path);
+		return false;
+	}
+
+	if(numUnused > 0)
+	{
+		fprintf(stderr, "%s:%" PRIu32 ":%" PRIu32 ": warning: %" PRIu32 " coefficient(s) use bits 0-3 which are ignored.\n",
+		        path, firstUnused->line, firstUnused->col, numUnused);
+	}
+
+	out = std::move(profiles);
+
+	return true;
+}
+
+static bool readCache(const std::string &cachePath, const CacheHeader &expected, std::vector<CachedProfile> &profiles)
+{
+	FILE *const f = fopen(cachePath.c_str(), "rb");
+	if(f == nullptr) return false;
+
+	CacheHeader hdr;
+	bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == expected.magic && hdr.version == expected.version &&
+	          hdr.srcSize == expected.srcSize && hdr.srcTime == expected.srcTime && hdr.numProfiles > 0;
+	if(ok)
+	{
+		profiles.resize(hdr.numProfiles);
+		ok = fread(profiles.data(), sizeof(CachedProfile), hdr.numProfiles, f) == hdr.numProfiles;
+	}
+	fclose(f);
+
+	return ok;
+}
+
+// Failing to write the cache is not an error. It's only slower next time.
+static void writeCache(const std::string &cachePath, CacheHeader hdr, const std::vector<CachedProfile> &profiles)
+{
+	FILE *const f = fopen(cachePath.c_str(), "wb");
+	if(f == nullptr) return;
+
+	hdr.numProfiles = profiles.size();
+	bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	ok &= fwrite(profiles.data(), sizeof(CachedProfile), profiles.size(), f) == profiles.size();
+	ok &= fclose(f) == 0;
+
+	if(!ok) remove(cachePath.c_str());
+}
+
+bool loadMatrixFile(const char *const path, std::vector<MatrixProfile> &profiles)
+{
+	std::error_code ec;
+	const u64 srcSize = std::filesystem::file_size(path, ec);
+	const auto srcTime = std::filesystem::last_write_time(path, ec);
+	if(ec)
+	{
+		fprintf(stderr, "%s: error: %s\n", path, ec.message().c_str());
+		return false;
+	}
+
+	const CacheHeader expected = {CACHE_MAGIC, CACHE_VERSION, srcSize, (s64)srcTime.time_since_epoch().count(), 0, 0};
+	const std::string cachePath = std::string(path) + ".cache";
+	std::vector<CachedProfile> parsed;
+	if(!readCache(cachePath, expected, parsed))
+	{
+		std::ifstream file(path, std::ios::binary);
+		if(!file)
+		{
+			fprintf(stderr, "%s: error: %s\n", path, strerror(errno));
+			return false;
+		}
+		const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		const std::string defaultName = std::filesystem::path(path).stem().string();
+		if(!parseMatrixText(path, text, defaultName, parsed)) return false;
+
+		writeCache(cachePath, expected, parsed);
+	}
+
+	profiles.clear();
+	for(const CachedProfile &p : parsed)
+	{
+		MatrixProfile profile;
+		profile.name = p.name;
+		profile.params = {};
+		profile.params.hPatt = p.hPatt;
+		profile.params.hLen = p.hLen;
+		profile.params.vPatt = p.vPatt;
+		profile.params.vLen = p.vLen;
+		memcpy(profile.params.hMatrix, p.hMatrix, sizeof(p.hMatrix));
+		memcpy(profile.params.vMatrix, p.vMatrix, sizeof(p.vMatrix));
+		profiles.push_back(std::move(profile));
+	}
+
+	return true;
+}
+
+bool loadMatrixProfile(const char *const spec, ScalerParams &params)
+{
+	std::string path(spec);
+	std::string name;
+	const size_t sep = path.rfind(':');
+	if(!std::filesystem::exists(path) && sep != std::string::npos)
+	{
+		name = path.substr(sep + 1);
+		path.resize(sep);
+	}
+
+	std::vector<MatrixProfile> profiles;
+	if(!loadMatrixFile(path.c_str(), profiles)) return false;
+
+	for(const MatrixProfile &profile : profiles)
+	{
+		if(name.empty() || profile.name == name)
+		{
+			params.hPatt = profile.params.hPatt;
+			params.hLen = profile.params.hLen;
+			params.vPatt = profile.params.vPatt;
+			params.vLen = profile.params.vLen;
+			memcpy(params.hMatrix, profile.params.hMatrix, sizeof(params.hMatrix));
+			memcpy(params.vMatrix, profile.params.vMatrix, sizeof(params.vMatrix));
+			return true;
+		}
+	}
+
+	fprintf(stderr, "%s: error: No profile named '%s'.\n", path.c_str(), name.c_str());
+
+	return false;
+}
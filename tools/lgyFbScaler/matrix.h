@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+#include "scaler.h"
+
+
+// Matrix file format:
+// [name]                    Optional. Starts a named profile.
+// 00011011, 6,              Horizontal pattern (binary) and length.
+// 0, 0x2000, ...            48 coefficients (6 rows of 8).
+// 00011011, 6,              Vertical pattern and length.
+// 0, 0x2000, ...            48 coefficients.
+//
+// Values are separated by commas and/or whitespace. '#' and "//" start
+// a comment. Files without a [name] line contain one profile named
+// after the file.
+struct MatrixProfile final
+{
+	std::string name;
+	ScalerParams params; // Only the pattern, length and matrix fields are set.
+};
+
+
+// Parses all profiles in a matrix file. Errors are printed with line
+// and column. Parsed profiles are cached in "<path>.cache" and the cache
+// is used as long as the matrix file doesn't change.
+bool loadMatrixFile(const char *const path, std::vector<MatrixProfile> &profiles);
+
+// spec is "file" for the first profile or "file:name".
+// Only the pattern, length and matrix fields of params are changed.
+bool loadMatrixProfile(const char *const spec, ScalerParams &params);
@@ -0,0 +1,384 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "lodepng.h"
+#include "kernels.h"
+#include "optimizer.h"
+
+
+#define SYNTH_LINES     (384u)
+#define SYNTH_LINE_LEN  (240u) // GBA screen width.
+#define COEFF_MIN       (-0x8000)
+#define COEFF_MAX       (0x7FF0)  // Bits 0-3 are not used.
+#define COEFF_ONE       (0x4000)
+
+
+struct Line final
+{
+	std::vector<u8> in;
+	std::vector<u8> target;
+};
+
+// All samples using the same matrix column (pattern position) in SoA layout
+// so the inner loop of the error function vectorizes.
+struct PhaseSamples final
+{
+	std::vector<s32> x[6]; // Input pixel for each tap.
+	std::vector<s32> t;    // Target value.
+};
+
+
+static void resampleLine(Line &line, const Kernel kernel, const u32 outLen)
+{
+	const u32 inLen = line.in.size();
+	const double scale = (double)outLen / inLen;
+	line.target.resize(outLen);
+	for(u32 j = 0; j < outLen; j++)
+	{
+		double w[8];
+		const s32 first = kernelWeights(kernel, outCenter(j, inLen, outLen), scale, w);
+
+		double val = 0.;
+		for(u8 i = 0; i < 8; i++)
+		{
+			const s32 pos = std::clamp<s32>(first + i, 0, inLen - 1);
+			val += w[i] * line.in[pos];
+		}
+		line.target[j] = (u8)std::clamp(std::lround(val), 0l, 255l);
+	}
+}
+
+// Area (box) downscale of a reference line to create the input line.
+static void downscaleLine(Line &line, const u32 inLen)
+{
+	const u32 refLen = line.target.size();
+	const double f = (double)refLen / inLen;
+	line.in.resize(inLen);
+	for(u32 k = 0; k < inLen; k++)
+	{
+		const double start = k * f;
+		const double end = start + f;
+		double val = 0.;
+		for(u32 r = (u32)start; r < refLen && r < end; r++)
+		{
+			const double cover = std::min<double>(end, r + 1) - std::max<double>(start, r);
+			val += cover * line.target[r];
+		}
+		line.in[k] = (u8)std::clamp(std::lround(val / f), 0l, 255l);
+	}
+}
+
+static void addSyntheticLines(std::vector<Line> &lines)
+{
+	std::mt19937 rng(0x4F4146u);
+	std::uniform_int_distribution<u32> val(0, 255);
+	std::uniform_int_distribution<u32> run(1, 8);
+	for(u32 l = 0; l < SYNTH_LINES; l++)
+	{
+		Line line;
+		line.in.resize(SYNTH_LINE_LEN);
+		switch(l % 4)
+		{
+			case 0: // Noise.
+				for(auto &px : line.in) px = val(rng);
+				break;
+			case 1: // Flat areas with hard edges (tiles/sprites).
+				for(u32 i = 0; i < SYNTH_LINE_LEN;)
+				{
+					const u8 v = val(rng);
+					for(u32 r = run(rng); r > 0 && i < SYNTH_LINE_LEN; r--) line.in[i++] = v;
+				}
+				break;
+			case 2: // Gradients.
+			{
+				const u32 a = val(rng), b = val(rng);
+				for(u32 i = 0; i < SYNTH_LINE_LEN; i++)
+					line.in[i] = (u8)(a + ((s32)b - (s32)a) * (s32)i / (s32)(SYNTH_LINE_LEN - 1));
+				break;
+			}
+			case 3: // 1 pixel details (fonts).
+				for(u32 i = 0; i < SYNTH_LINE_LEN; i++) line.in[i] = ((i + l) % (2 + l % 3) == 0 ? 255 : 0);
+				break;
+		}
+		lines.push_back(std::move(line));
+	}
+}
+
+// Rows and columns of every color channel each become one line.
+static bool addImageLines(std::vector<Line> &lines, const char *const path, const bool isRef)
+{
+	unsigned char *img;
+	u32 width, hight;
+	u32 lpngErr;
+	if((lpngErr = lodepng_decode32_file(&img, &width, &hight, path)))
+	{
+		fprintf(stderr, "lodepng error: %s: %s\n", path, lodepng_error_text(lpngErr));
+		return false;
+	}
+
+	for(u8 c = 0; c < 3; c++)
+	{
+		for(u32 h = 0; h < hight; h++)
+		{
+			Line line;
+			std::vector<u8> &dst = (isRef ? line.target : line.in);
+			dst.resize(width);
+			for(u32 w = 0; w < width; w++) dst[w] = img[(width * h + w) * 4 + c];
+			lines.push_back(std::move(line));
+		}
+
+		for(u32 w = 0; w < width; w++)
+		{
+			Line line;
+			std::vector<u8> &dst = (isRef ? line.target : line.in);
+			dst.resize(hight);
+			for(u32 h = 0; h < hight; h++) dst[h] = img[(width * h + w) * 4 + c];
+			lines.push_back(std::move(line));
+		}
+	}
+
+	free(img);
+
+	return true;
+}
+
+// Runs the hardware position logic over a line and sorts all output
+// pixels by pattern position. The taps only depend on the pattern
+// so this is done once instead of for every evaluated matrix.
+static void gatherSamples(const Line &line, const u8 patt, const u8 pattLen, PhaseSamples samples[8])
+{
+	const u32 inLen = line.in.size();
+	Scaler scaler(nullptr, inLen, nullptr, patt, pattLen);
+	for(u32 j = 0; j < line.target.size(); j++)
+	{
+		PhaseSamples &s = samples[scaler.pattPos()];
+		for(u8 i = 0; i < 6; i++) s.x[i].push_back(line.in[scaler.tapIndex(i)]);
+		s.t.push_back(line.target[j]);
+		scaler.next();
+	}
+}
+
+// Same math as Scaler::calcPixel() for a single channel.
+static u64 phaseError(const PhaseSamples &s, const s32 c[6]) noexcept
+{
+	const s32 *const __restrict x0 = s.x[0].data();
+	const s32 *const __restrict x1 = s.x[1].data();
+	const s32 *const __restrict x2 = s.x[2].data();
+	const s32 *const __restrict x3 = s.x[3].data();
+	const s32 *const __restrict x4 = s.x[4].data();
+	const s32 *const __restrict x5 = s.x[5].data();
+	const s32 *const __restrict t = s.t.data();
+	const s32 c0 = c[0], c1 = c[1], c2 = c[2], c3 = c[3], c4 = c[4], c5 = c[5];
+	const u32 num = s.t.size();
+
+	u64 err = 0;
+	for(u32 n = 0; n < num; n++)
+	{
+		s32 acc = c0 * x0[n] + c1 * x1[n] + c2 * x2[n] + c3 * x3[n] + c4 * x4[n] + c5 * x5[n];
+		acc = (acc > 0x3FC000 ? 0x3FC000 : acc);
+		acc = (acc < 0 ? 0 : acc);
+
+		const s32 diff = (acc>>14) - t[n];
+		err += (u32)(diff * diff);
+	}
+
+	return err;
+}
+
+template<typename F> static void parallelFor(const u32 num, F &&func)
+{
+	const u32 hwThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	const u32 numThreads = std::min(hwThreads, num);
+
+	std::vector<std::thread> threads;
+	for(u32 t = 1; t < numThreads; t++)
+	{
+		threads.emplace_back([&func, num, numThreads, t]()
+		{
+			for(u32 i = t; i < num; i += numThreads) func(i);
+		});
+	}
+	for(u32 i = 0; i < num; i += numThreads) func(i);
+
+	for(auto &thread : threads) thread.join();
+}
+
+// Maps the kernel weights of a representative output pixel
+// onto the taps and quantizes them to what the hardware can use.
+static void initialGuess(const Kernel kernel, const u8 patt, const u8 pattLen, s32 coeffs[8][6])
+{
+	const u32 inLen = SYNTH_LINE_LEN;
+	const u32 outLen = inLen * pattLen / __builtin_popcount(patt);
+	Scaler scaler(nullptr, inLen, nullptr, patt, pattLen);
+
+	// Skip to the middle of the line to avoid edge clamping.
+	u32 j = 0;
+	for(; j < outLen / 2 - outLen / 2 % pattLen; j++) scaler.next();
+
+	for(u8 p = 0; p < pattLen; p++, j++)
+	{
+		double w[8];
+		const s32 first = kernelWeights(kernel, outCenter(j, inLen, outLen), (double)outLen / inLen, w);
+
+		double tapW[6] = {};
+		double sum = 0.;
+		for(u8 k = 0; k < 8; k++)
+		{
+			for(u8 i = 0; i < 6; i++)
+			{
+				if(scaler.tapIndex(i) == (u32)(first + k))
+				{
+					tapW[i] += w[k];
+					sum += w[k];
+					break;
+				}
+			}
+		}
+
+		s32 qSum = 0;
+		u8 maxTap = 0;
+		for(u8 i = 0; i < 6; i++)
+		{
+			coeffs[p][i] = (sum != 0. ? std::lround(tapW[i] / sum * COEFF_ONE / 16) * 16 : 0);
+			qSum += coeffs[p][i];
+			if(coeffs[p][i] > coeffs[p][maxTap]) maxTap = i;
+		}
+		coeffs[p][maxTap] += COEFF_ONE - qSum; // Keep the DC gain at exactly 1.
+
+		scaler.next();
+	}
+}
+
+// Coordinate descent. Candidates move step from one tap to another
+// which keeps the coefficients quantized and the DC gain at 1.
+// All 30 candidates per iteration are evaluated in parallel.
+static u64 optimizePhase(const PhaseSamples &s, s32 c[6])
+{
+	u64 bestErr = phaseError(s, c);
+	for(s32 step = 0x800; step >= 16; step >>= 1)
+	{
+		while(1)
+		{
+			u64 errs[30];
+			parallelFor(30, [&](u32 idx)
+			{
+				const u8 from = idx / 5;
+				u8 to = idx % 5;
+				to += (to >= from);
+
+				s32 cand[6];
+				memcpy(cand, c, sizeof(cand));
+				cand[from] -= step;
+				cand[to] += step;
+				if(cand[from] < COEFF_MIN || cand[to] > COEFF_MAX) errs[idx] = UINT64_MAX;
+				else                                               errs[idx] = phaseError(s, cand);
+			});
+
+			const u32 best = std::min_element(errs, errs + 30) - errs;
+			if(errs[best] >= bestErr) break;
+
+			const u8 from = best / 5;
+			const u8 to = best % 5 + (best % 5 >= from);
+			c[from] -= step;
+			c[to] += step;
+			bestErr = errs[best];
+		}
+	}
+
+	return bestErr;
+}
+
+bool optimizeMatrix(u8 patt, u8 pattLen, const char *const target, const char *const *const images,
+                    u32 numImages, s16 matrixOut[8 * 6])
+{
+	Kernel kernel;
+	if(!str2Kernel(target, kernel))
+	{
+		fprintf(stderr, "Error: Unknown target '%s'.\n", target);
+		return false;
+	}
+	if(pattLen < 1 || pattLen > 8 || (patt & ((1u<<pattLen) - 1)) == 0)
+	{
+		fputs("Error: Invalid pattern.\n", stderr);
+		return false;
+	}
+	if(kernel == Kernel::ref && numImages == 0)
+	{
+		fputs("Error: Reference mode needs at least 1 image.\n", stderr);
+		return false;
+	}
+
+	// Ignore pattern bits beyond the length. The hardware doesn't use them.
+	patt &= (1u<<pattLen) - 1;
+	const u32 pop = __builtin_popcount(patt);
+
+	std::vector<Line> lines;
+	for(u32 i = 0; i < numImages; i++)
+	{
+		if(!addImageLines(lines, images[i], kernel == Kernel::ref)) return false;
+	}
+	if(numImages == 0) addSyntheticLines(lines);
+
+	PhaseSamples samples[8];
+	for(Line &line : lines)
+	{
+		if(kernel == Kernel::ref)
+		{
+			const u32 inLen = line.target.size() * pop / pattLen;
+			if(inLen == 0) continue;
+			downscaleLine(line, inLen);
+			line.target.resize(inLen * pattLen / pop);
+		}
+		else resampleLine(line, kernel, line.in.size() * pattLen / pop);
+
+		gatherSamples(line, patt, pattLen, samples);
+	}
+
+	s32 coeffs[8][6];
+	initialGuess(kernel, patt, pattLen, coeffs);
+
+	u64 startErr = 0, endErr = 0, numSamples = 0;
+	for(u8 p = 0; p < pattLen; p++)
+	{
+		startErr += phaseError(samples[p], coeffs[p]);
+		endErr += optimizePhase(samples[p], coeffs[p]);
+		numSamples += samples[p].t.size();
+	}
+	if(numSamples == 0)
+	{
+		fputs("Error: No samples. Images too small?\n", stderr);
+		return false;
+	}
+
+	printf("Samples: %" PRIu64 "\nRMSE: %f -> %f\n", numSamples,
+	       std::sqrt((double)startErr / numSamples), std::sqrt((double)endErr / numSamples));
+
+	memset(matrixOut, 0, sizeof(s16) * 8 * 6);
+	for(u8 p = 0; p < pattLen; p++)
+	{
+		for(u8 i = 0; i < 6; i++) matrixOut[i * 8 + p] = (s16)coeffs[p][i];
+	}
+
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scaler.h"
+
+
+// Searches the coefficient space of one 6x8 matrix for the given pattern
+// so the simulated hardware output matches the target as close as possible.
+//
+// target is either a kernel name ("bilinear", "sharp-bilinear", "bicubic",
+// "lanczos2", "lanczos3") in which case the images are the low-res inputs
+// (synthetic lines are used without images) or "ref" in which case the images
+// are high-res references which get downscaled to create the inputs.
+//
+// The matrix is only written on success.
+bool optimizeMatrix(u8 patt, u8 pattLen, const char *const target, const char *const *const images,
+                    u32 numImages, s16 matrixOut[8 * 6]);
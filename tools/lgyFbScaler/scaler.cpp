@@ -0,0 +1,85 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <new>
+#include "scaler.h"
+#include "scaler_fixed.h"
+
+
+
+void scaleFrame(Pixel *buf, const ScalerParams &params)
+{
+	std::unique_ptr<Pixel[]> tmpBuf(new(std::nothrow) Pixel[512 * 512]);
+	std::unique_ptr<Pixel[]> tmpLine(new(std::nothrow) Pixel[512 + FIXED_LINE_PAD * 2]);
+	const u16 oWidth = params.oWidth;
+	const u16 oHight = params.oHight;
+	const u16 width = params.width;
+
+	// The generic scaler doesn't reset the pattern position between lines.
+	// Fixed kernels always start at position 0 so lines must end on a pattern boundary.
+	const LineKernel hKernel = getFixedLineKernel(params.hPatt, params.hLen);
+	if(hKernel != nullptr && width % params.hLen == 0)
+	{
+		for(u16 h = 0; h < oHight; h++)
+		{
+			padLine(tmpLine.get(), &buf[oWidth * h], oWidth, 1);
+			hKernel(tmpLine.get(), width, &tmpBuf[width * h], 1, params.hMatrix);
+		}
+	}
+	else
+	{
+		Scaler scaler(buf, oWidth, params.hMatrix, params.hPatt, params.hLen);
+		for(u16 h = 0; h < oHight; h++)
+		{
+			for(u16 w = 0; w < width; w++)
+			{
+				tmpBuf[width * h + w] = scaler.calcPixel();
+				scaler.next();
+			}
+
+			scaler.nextLine();
+		}
+	}
+
+	const u16 hight = params.hight;
+	const LineKernel vKernel = getFixedLineKernel(params.vPatt, params.vLen);
+	if(vKernel != nullptr)
+	{
+		for(u16 w = 0; w < width; w++)
+		{
+			padLine(tmpLine.get(), &tmpBuf[w], oHight, width);
+			vKernel(tmpLine.get(), hight, &buf[w], width, params.vMatrix);
+		}
+	}
+	else
+	{
+		Scaler scaler(tmpLine.get(), oHight, params.vMatrix, params.vPatt, params.vLen);
+		for(u16 w = 0; w < width; w++)
+		{
+			for(u16 h = 0; h < oHight; h++)
+				tmpLine[h] = tmpBuf[width * h + w];
+
+			for(u16 h = 0; h < hight; h++)
+			{
+				buf[width * h + w] = scaler.calcPixel();
+				scaler.next();
+			}
+			scaler.resetLine();
+		}
+	}
+}
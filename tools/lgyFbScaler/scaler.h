@@ -0,0 +1,184 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cinttypes>
+
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t  s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+
+typedef struct
+{
+	u16 oWidth;
+	u16 oHight;
+	u16 width;
+	u16 hight;
+	s16 vMatrix[8 * 6];
+	s16 hMatrix[8 * 6];
+	u8  vPatt;
+	u8  hPatt;
+	u8  vLen;
+	u8  hLen;
+} ScalerParams;
+
+struct Pixel final
+{
+	u8 m_r, m_g, m_b, m_a;
+
+
+	// Constructors
+	Pixel(void) noexcept {}
+	Pixel(u8 r, u8 g, u8 b, u8 a = 0xFFu) noexcept : m_r(r), m_g(g), m_b(b), m_a(a) {}
+	Pixel(const Pixel&) noexcept = delete; // Copy
+	Pixel(Pixel&&) noexcept = delete;      // Move
+
+	// Destructors
+	//~Pixel(void) noexcept = default;
+
+	// Operators
+	Pixel& operator =(const Pixel&) noexcept = default; // Copy
+	Pixel& operator =(Pixel&&) noexcept = default;      // Move
+
+	// Functions
+};
+
+class Scaler final
+{
+	const Pixel *m_buf;
+	const s16 *const m_matrix;
+	s16 m_pos;
+	const u16 m_lineLen;
+	const u8 m_patt;
+	const u8 m_pattLen;
+	u8 m_pattPos;
+
+
+	// Constructors
+	Scaler(void) noexcept = delete;
+	Scaler(const Scaler&) noexcept = delete; // Copy
+	Scaler(Scaler&&) noexcept = delete;      // Move
+
+	// Destructors
+	//~Scaler(void) noexcept = default;
+
+	// Operators
+	Scaler& operator =(const Scaler&) noexcept = delete; // Copy
+	Scaler& operator =(Scaler&&) noexcept = delete;      // Move
+
+	const Pixel& operator [](u8 idx) const noexcept
+	{
+		return m_buf[tapIndex(idx)];
+	}
+
+	// Functions
+
+
+public:
+	// Constructors
+	Scaler(const Pixel *buf, u16 lineLen, const s16 *matrix, u8 patt, u8 pattLen) noexcept
+	: m_buf(buf), m_matrix(matrix), m_pos(0), m_lineLen(lineLen), m_patt(patt), m_pattLen(pattLen), m_pattPos(0)
+	{
+	}
+
+	// Destructors
+
+	// Operators
+
+	// Functions
+	// Returns the line position of the input pixel multiplied with tap idx.
+	// Only depends on the pattern so it can be used without a buffer.
+	u32 tapIndex(u8 idx) const noexcept
+	{
+		//idx = (idx > 5 ? 5 : idx);
+
+		idx = 5 - idx;
+		u32 bufPos;
+		if(m_pos - idx <= 0)               bufPos = 0;             // Output first pixel for lower out of bounds.
+		else if(m_pos - idx >= m_lineLen)  bufPos = m_lineLen - 1; // Output last pixel for upper out of bounds.
+		else                               bufPos = m_pos - idx;   // Normal pixel window offset.
+
+		return bufPos;
+	}
+
+	u8 pattPos(void) const noexcept
+	{
+		return m_pattPos;
+	}
+
+	Pixel calcPixel(void) const noexcept
+	{
+		s32 r = 0, g = 0, b = 0;
+		const s16 *matrix = &m_matrix[m_pattPos];
+		for(u8 i = 0; i < 6; i++)
+		{
+			const Pixel &pixel = (*this)[i];
+			const s16 mult = matrix[i * 8];
+
+			r += pixel.m_r * mult;
+			g += pixel.m_g * mult;
+			b += pixel.m_b * mult;
+		}
+
+		// Clamp the result.
+		r = (r > 0x3FC000 ? 0x3FC000 : r);
+		r = (r < 0 ? 0 : r);
+		g = (g > 0x3FC000 ? 0x3FC000 : g);
+		g = (g < 0 ? 0 : g);
+		b = (b > 0x3FC000 ? 0x3FC000 : b);
+		b = (b < 0 ? 0 : b);
+
+		return Pixel(r / 0x4000, g / 0x4000, b / 0x4000);
+	}
+
+	void next(void) noexcept
+	{
+		if(m_patt & 1u<<m_pattPos++)
+		{
+			if(m_pos == 0) m_pos = 3; // Hardware loads 3 more pixels after the first.
+			else           m_pos++;
+		}
+
+		if(m_pattPos == m_pattLen) m_pattPos = 0;
+	}
+
+	void nextLine(void) noexcept
+	{
+		m_buf += m_lineLen;
+		m_pos = 0;
+	}
+
+	void resetLine(void) noexcept
+	{
+		m_pos = 0;
+		m_pattPos = 0;
+	}
+};
+
+
+// Scales the image in buf (oWidth x oHight) to width x hight in place.
+// buf must have room for 512 * 512 pixels.
+void scaleFrame(Pixel *buf, const ScalerParams &params);
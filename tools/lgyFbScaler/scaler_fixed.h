@@ -0,0 +1,141 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+#include "scaler.h"
+
+
+// Pixels of padding on both sides of the line passed to fixed kernels.
+// Left: Tap 0 reads 5 pixels behind the position.
+// Right: The position overshoots the line end by up to 3 pixels.
+#define FIXED_LINE_PAD  (8u)
+
+// Line kernels read from a padded line (see padLine()) and write
+// outLen pixels with outStride pixels between them.
+typedef void (*LineKernel)(const Pixel *line, u16 outLen, Pixel *out, u32 outStride, const s16 *matrix);
+
+
+// Copies a line and repeats the first/last pixel in the padding which
+// is the same as the out of bounds clamping in Scaler::operator [].
+// dst must have room for len + FIXED_LINE_PAD * 2 pixels.
+static inline void padLine(Pixel *dst, const Pixel *src, u16 len, u32 srcStride) noexcept
+{
+	for(u32 i = 0; i < FIXED_LINE_PAD; i++) dst[i] = src[0];
+	dst += FIXED_LINE_PAD;
+	for(u32 i = 0; i < len; i++) dst[i] = src[srcStride * i];
+	for(u32 i = 0; i < FIXED_LINE_PAD; i++) dst[len + i] = src[srcStride * (len - 1)];
+}
+
+// Same as Scaler::calcPixel() with the window starting at win.
+static inline Pixel calcPixelFixed(const Pixel *const win, const s32 c[6]) noexcept
+{
+	s32 r = 0, g = 0, b = 0;
+	for(u8 i = 0; i < 6; i++)
+	{
+		r += win[i].m_r * c[i];
+		g += win[i].m_g * c[i];
+		b += win[i].m_b * c[i];
+	}
+
+	// Clamp the result.
+	r = (r > 0x3FC000 ? 0x3FC000 : r);
+	r = (r < 0 ? 0 : r);
+	g = (g > 0x3FC000 ? 0x3FC000 : g);
+	g = (g < 0 ? 0 : g);
+	b = (b > 0x3FC000 ? 0x3FC000 : b);
+	b = (b < 0 ? 0 : b);
+
+	return Pixel(r / 0x4000, g / 0x4000, b / 0x4000);
+}
+
+template<u8 Patt, bool First, u8 P>
+static inline void fixedStep(const Pixel *const line, s32 &pos, Pixel *&out, const u32 outStride, const s32 (&c)[8][6]) noexcept
+{
+	// The first advance of a line jumps to 3. See Scaler::next().
+	constexpr u8 firstAdvance = __builtin_ctz(Patt);
+
+	*out = calcPixelFixed(&line[pos - 5], c[P]);
+	out += outStride;
+
+	if constexpr((Patt & 1u<<P) != 0)
+	{
+		if constexpr(First && P == firstAdvance) pos = 3;
+		else                                     pos++;
+	}
+}
+
+template<u8 Patt, bool First, size_t... P>
+static inline void fixedPeriod(const Pixel *const line, s32 &pos, Pixel *&out, const u32 outStride, const s32 (&c)[8][6],
+                               std::index_sequence<P...>) noexcept
+{
+	(fixedStep<Patt, First, P>(line, pos, out, outStride, c), ...);
+}
+
+template<u8 Patt, u8 Len>
+static void scaleLineFixed(const Pixel *line, u16 outLen, Pixel *out, u32 outStride, const s16 *matrix)
+{
+	static_assert(Len >= 1 && Len <= 8, "Invalid pattern length.");
+	static_assert(Patt != 0 && (Patt & ~((1u<<Len) - 1)) == 0, "Invalid pattern.");
+
+	// Transpose the used matrix columns for linear access.
+	s32 c[8][6];
+	for(u8 p = 0; p < Len; p++)
+	{
+		for(u8 i = 0; i < 6; i++) c[p][i] = matrix[i * 8 + p];
+	}
+
+	line += FIXED_LINE_PAD;
+	s32 pos = 0;
+	u32 left = outLen;
+	if(left >= Len)
+	{
+		fixedPeriod<Patt, true>(line, pos, out, outStride, c, std::make_index_sequence<Len>{});
+		left -= Len;
+
+		for(; left >= Len; left -= Len)
+			fixedPeriod<Patt, false>(line, pos, out, outStride, c, std::make_index_sequence<Len>{});
+	}
+
+	// Partial period at the end of the line (or lines shorter than 1 period).
+	for(u8 p = 0; p < left; p++)
+	{
+		*out = calcPixelFixed(&line[pos - 5], c[p]);
+		out += outStride;
+
+		if(Patt & 1u<<p) pos = (pos == 0 ? 3 : pos + 1);
+	}
+}
+
+// Returns a specialized kernel for the pattern or nullptr
+// if the generic Scaler needs to be used.
+static inline LineKernel getFixedLineKernel(u8 patt, u8 len) noexcept
+{
+	if(len < 1 || len > 8) return nullptr;
+	patt &= (1u<<len) - 1; // Bits beyond the length are never used.
+
+	// matrixGba.txt (x1.5).
+	if(patt == 0b011011u && len == 6) return scaleLineFixed<0b011011u, 6>;
+	// matrixDs.txt (x1.25).
+	if(patt == 0b01111u && len == 5)  return scaleLineFixed<0b01111u, 5>;
+	// Simple x1.5 and x2 patterns.
+	if(patt == 0b011u && len == 3)    return scaleLineFixed<0b011u, 3>;
+	if(patt == 0b01u && len == 2)     return scaleLineFixed<0b01u, 2>;
+
+	return nullptr;
+}
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+# open_agb_firm save converter
+#
+# Converts .sav files between emulators and open_agb_firm. The save is padded or truncated to the
+# size of the given save type (same rules as the converter open_agb_firm runs at launch, see
+# source/arm11/save_convert.c) and optionally the byte order of EEPROM saves is swapped.
+# Most emulators store each 64 bit EEPROM block in the opposite byte order.
+#
+# Usage: save-converter.py [--swap-eeprom] [--force] <save type> <in.sav> <out.sav>
+# Save type is the number used by the defaultSave/saveType settings (0-14).
+
+import sys
+
+CHUNK_SIZE = 4096
+MAX_FOOTER_SIZE = 0x100
+
+# Same as saveTypeSize() in the firmware
+def savetypesize(savetype):
+    if savetype < 2:
+        return 0x200
+    if savetype < 4:
+        return 0x2000
+    if savetype < 10:
+        return 0x10000
+    if savetype < 14:
+        return 0x20000
+    if savetype == 14:
+        return 0x8000
+    return 0
+
+# Reverse the byte order of every 64 bit block
+def swapeeprom(chunk):
+    out = bytearray(len(chunk))
+    for i in range(0, len(chunk) - 7, 8):
+        out[i:i + 8] = chunk[i:i + 8][::-1]
+    return bytes(out)
+
+# Check if everything after expected is emulator footer, padding or a mirror of the save
+def disposabletail(infile, expected, size):
+    if size - expected <= MAX_FOOTER_SIZE:
+        return True
+
+    chunksize = min(expected, CHUNK_SIZE)
+    erased = zero = True
+    mirror = size % expected == 0
+    pos = expected
+    while pos < size and (erased or zero or mirror):
+        infile.seek(pos)
+        chunk = infile.read(min(size - pos, chunksize))
+        erased = erased and chunk.count(0xFF) == len(chunk)
+        zero = zero and chunk.count(0) == len(chunk)
+        if mirror:
+            infile.seek(pos % expected)
+            mirror = infile.read(len(chunk)) == chunk
+        pos += len(chunk)
+
+    return erased or zero or mirror
+
+if __name__ == '__main__':
+    args = [a for a in sys.argv[1:] if not a.startswith('--')]
+    swap = '--swap-eeprom' in sys.argv
+    force = '--force' in sys.argv
+    if len(args) != 3:
+        sys.exit('Usage: save-converter.py [--swap-eeprom] [--force] <save type> <in.sav> <out.sav>')
+
+    savetype = int(args[0], 0)
+    expected = savetypesize(savetype)
+    if expected == 0:
+        sys.exit('Error: Invalid save type.')
+    if swap and savetype >= 4:
+        sys.exit('Error: --swap-eeprom only works with EEPROM save types (0-3).')
+
+    with open(args[1], 'rb') as infile, open(args[2], 'wb') as outfile:
+        infile.seek(0, 2)
+        size = infile.tell()
+        if size > expected and not force and not disposabletail(infile, expected, size):
+            sys.exit('Error: Save is bigger than the save type and the extra data looks like save data. '
+                     'Wrong save type? Use --force to truncate anyway.')
+
+        infile.seek(0)
+        pos = 0
+        while pos < min(size, expected):
+            chunk = infile.read(min(min(size, expected) - pos, CHUNK_SIZE))
+            outfile.write(swapeeprom(chunk) if swap else chunk)
+            pos += len(chunk)
+
+        # Pad with erased flash/EEPROM state.
+        while pos < expected:
+            pad = min(expected - pos, CHUNK_SIZE)
+            outfile.write(b'\xFF' * pad)
+            pos += pad
+
+    print('Converted %d bytes to %d bytes.' % (size, expected))